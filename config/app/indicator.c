@@ -28,6 +28,7 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #define GREEN (RGB(0x00, 0xFF, 0x00))
 
 static const struct device *led_strip;
+static int strip_indicator;
 
 static struct indicator_settings settings = {
 	.enable = true,
@@ -51,7 +52,7 @@ static void indicator_update(struct k_work *work)
 {
 	if (!settings.enable) {
 		unsigned int key = irq_lock();
-		led_strip_remap_clear(led_strip, STRIP_INDICATOR_LABEL);
+		led_strip_remap_clear_by_id(led_strip, strip_indicator);
 		irq_unlock(key);
 		return;
 	}
@@ -65,7 +66,7 @@ static void indicator_update(struct k_work *work)
 		current.g, current.b, bri, color.r, color.g, color.b);
 
 	unsigned int key = irq_lock();
-	led_strip_remap_set(led_strip, STRIP_INDICATOR_LABEL, &color);
+	led_strip_remap_set_by_id(led_strip, strip_indicator, &color);
 	irq_unlock(key);
 }
 
@@ -160,7 +161,7 @@ static void indicator_preview_brightness(uint8_t brightness)
 		current.g, current.b, brightness, color.r, color.g, color.b);
 
 	unsigned int key = irq_lock();
-	led_strip_remap_set(led_strip, "STATUS", &color);
+	led_strip_remap_set_by_id(led_strip, strip_indicator, &color);
 	irq_unlock(key);
 
 	k_work_reschedule(&indicator_clear_preview_work, K_MSEC(2000));
@@ -216,6 +217,11 @@ static int indicator_init(const struct device *dev)
 
 	led_strip = DEVICE_DT_GET(STRIP_CHOSEN);
 
+	strip_indicator = led_strip_remap_find(led_strip, STRIP_INDICATOR_LABEL);
+	if (strip_indicator < 0) {
+		LOG_ERR("No indicator labeled %s on the LED strip", STRIP_INDICATOR_LABEL);
+	}
+
 #ifdef CONFIG_SETTINGS
 	ret = settings_subsys_init();
 	if (ret) {
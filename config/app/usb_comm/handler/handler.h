@@ -12,17 +12,64 @@
 typedef bool (*usb_comm_handler_t)(const usb_comm_MessageH2D *h2d, usb_comm_MessageD2H *d2h,
 				   const void *bytes, uint32_t bytes_len);
 
+enum usb_comm_handler_cost {
+	// Answered inline on the usb_comm thread
+	USB_COMM_HANDLER_FAST,
+	// Offloaded to the usb_comm worker, so that fast requests are not queued behind it
+	USB_COMM_HANDLER_SLOW,
+};
+
 struct usb_comm_handler_config {
 	usb_comm_Action action;
 	pb_size_t response_payload;
+	enum usb_comm_handler_cost cost;
 	usb_comm_handler_t handler;
 };
 
 #define USB_COMM_DEFINE_HANDLER(name) static STRUCT_SECTION_ITERABLE(usb_comm_handler_config, name)
 
-#define USB_COMM_HANDLER_DEFINE(_action, _payload, _handler)                                       \
+#define USB_COMM_HANDLER_DEFINE_COST(_action, _payload, _handler, _cost)                           \
 	USB_COMM_DEFINE_HANDLER(usb_comm_handler_##_handler) = {                                   \
 		.action = _action,                                                                 \
 		.response_payload = _payload,                                                      \
+		.cost = _cost,                                                                     \
 		.handler = _handler,                                                               \
 	};
+
+#define USB_COMM_HANDLER_DEFINE(_action, _payload, _handler)                                       \
+	USB_COMM_HANDLER_DEFINE_COST(_action, _payload, _handler, USB_COMM_HANDLER_FAST)
+
+const struct usb_comm_handler_config *usb_comm_handler_find(usb_comm_Action action);
+
+#define USB_COMM_LATENCY_BUCKETS  8
+#define USB_COMM_LATENCY_BASE_US 128
+
+// Time from a request being received to its response being sent. `buckets[i]` counts requests
+// answered within (USB_COMM_LATENCY_BASE_US << i) us, the last one also counts slower ones.
+struct usb_comm_latency {
+	uint32_t count;
+	uint32_t max_us;
+	uint32_t buckets[USB_COMM_LATENCY_BUCKETS];
+};
+
+int usb_comm_get_latency(usb_comm_Action action, struct usb_comm_latency *latency, bool reset);
+
+typedef bool (*usb_comm_stream_active_t)(void);
+typedef bool (*usb_comm_stream_poll_t)(usb_comm_MessageD2H *d2h);
+
+struct usb_comm_stream_config {
+	usb_comm_Action action;
+	pb_size_t payload;
+	usb_comm_stream_active_t active;
+	usb_comm_stream_poll_t poll;
+};
+
+#define USB_COMM_DEFINE_STREAM(name) static STRUCT_SECTION_ITERABLE(usb_comm_stream_config, name)
+
+#define USB_COMM_STREAM_DEFINE(_action, _payload, _active, _poll)                                  \
+	USB_COMM_DEFINE_STREAM(usb_comm_stream_##_poll) = {                                        \
+		.action = _action,                                                                 \
+		.payload = _payload,                                                               \
+		.active = _active,                                                                 \
+		.poll = _poll,                                                                     \
+	};
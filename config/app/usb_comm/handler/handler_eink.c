@@ -17,6 +17,22 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #include <pb_encode.h>
 #include <pb_decode.h>
 
+static enum eink_encoding eink_encoding_from_req(const usb_comm_EinkImage *req)
+{
+	if (!req->has_encoding) {
+		return EINK_ENCODING_RAW;
+	}
+
+	switch (req->encoding) {
+	case usb_comm_EinkImage_Encoding_RLE:
+		return EINK_ENCODING_RLE;
+	case usb_comm_EinkImage_Encoding_DELTA:
+		return EINK_ENCODING_DELTA;
+	default:
+		return EINK_ENCODING_RAW;
+	}
+}
+
 static bool handle_eink_set_image(const usb_comm_MessageH2D *h2d, usb_comm_MessageD2H *d2h,
 				  const void *bytes, uint32_t bytes_len)
 {
@@ -25,17 +41,36 @@ static bool handle_eink_set_image(const usb_comm_MessageH2D *h2d, usb_comm_Messa
 
 	res->id = req->id;
 
-	bool partial = req->has_partial && req->partial;
+	enum eink_encoding encoding = eink_encoding_from_req(req);
+	enum eink_refresh refresh = EINK_REFRESH_AUTO;
+	int ret;
+
+	if (req->has_partial) {
+		refresh = req->partial ? EINK_REFRESH_PARTIAL : EINK_REFRESH_FULL;
+	}
 
 	if (req->has_x && req->has_y && req->has_width && req->has_height) {
-		eink_update_region(bytes, bytes_len, req->x, req->y, req->width, req->height,
-				   partial);
+		ret = eink_update_region(bytes, bytes_len, encoding, req->x, req->y, req->width,
+					 req->height, refresh);
 	} else {
-		eink_update(bytes, bytes_len, partial);
+		ret = eink_update(bytes, bytes_len, encoding, refresh);
+	}
+
+	res->has_status = true;
+	switch (ret) {
+	case 0:
+		res->status = usb_comm_EinkImage_Status_OK;
+		break;
+	case -ENODATA:
+		res->status = usb_comm_EinkImage_Status_NO_BASE_FRAME;
+		break;
+	default:
+		res->status = usb_comm_EinkImage_Status_INVALID;
+		break;
 	}
 
 	return true;
 }
 
-USB_COMM_HANDLER_DEFINE(usb_comm_Action_EINK_SET_IMAGE, usb_comm_MessageD2H_eink_image_tag,
-			handle_eink_set_image);
+USB_COMM_HANDLER_DEFINE_COST(usb_comm_Action_EINK_SET_IMAGE, usb_comm_MessageD2H_eink_image_tag,
+			     handle_eink_set_image, USB_COMM_HANDLER_SLOW);
@@ -8,6 +8,7 @@
 #include "handler.h"
 #include "usb_comm.pb.h"
 
+#include <zephyr/kernel.h>
 #include <zephyr/device.h>
 #include <knob/drivers/knob.h>
 #include <knob/drivers/motor.h>
@@ -16,6 +17,9 @@
 
 #include <pb_encode.h>
 
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
 #define KNOB_NODE DT_ALIAS(knob)
 #define MOTOR_NODE DT_PHANDLE(KNOB_NODE, motor)
 
@@ -55,6 +59,262 @@ static bool handle_motor_get_state(const usb_comm_MessageH2D *h2d, usb_comm_Mess
 USB_COMM_HANDLER_DEFINE(usb_comm_Action_MOTOR_GET_STATE, usb_comm_MessageD2H_motor_state_tag,
 			handle_motor_get_state);
 
+#ifdef CONFIG_HW75_USB_COMM_MOTOR_STREAM
+typedef int32_t (*motor_state_series_t)(const struct motor_state *state);
+
+static struct motor_state stream_states[CONFIG_HW75_USB_COMM_MOTOR_STREAM_BATCH_SIZE];
+static int stream_count = 0;
+static bool stream_enable = false;
+static uint32_t stream_decimation = 0;
+// Samples dropped since the last batch pushed to the host
+static uint32_t stream_dropped = 0;
+
+static int32_t series_timestamp(const struct motor_state *state)
+{
+	return (int32_t)(state->timestamp - stream_states[0].timestamp);
+}
+
+static int32_t series_control_mode(const struct motor_state *state)
+{
+	return (int32_t)state->control_mode;
+}
+
+static int32_t series_current_angle(const struct motor_state *state)
+{
+	return (int32_t)(state->current_angle * 1000.0f);
+}
+
+static int32_t series_current_velocity(const struct motor_state *state)
+{
+	return (int32_t)(state->current_velocity * 1000.0f);
+}
+
+static int32_t series_target_angle(const struct motor_state *state)
+{
+	return (int32_t)(state->target_angle * 1000.0f);
+}
+
+static int32_t series_target_velocity(const struct motor_state *state)
+{
+	return (int32_t)(state->target_velocity * 1000.0f);
+}
+
+static int32_t series_target_voltage(const struct motor_state *state)
+{
+	return (int32_t)(state->target_voltage * 1000.0f);
+}
+
+static bool write_series_deltas(pb_ostream_t *stream, motor_state_series_t series)
+{
+	int32_t last = 0;
+	for (int i = 0; i < stream_count; i++) {
+		int32_t value = series(&stream_states[i]);
+		if (!pb_encode_svarint(stream, value - last)) {
+			return false;
+		}
+		last = value;
+	}
+	return true;
+}
+
+static bool write_series(pb_ostream_t *stream, const pb_field_t *field, void *const *arg)
+{
+	motor_state_series_t series = (motor_state_series_t)*arg;
+	pb_ostream_t sizing = PB_OSTREAM_SIZING;
+
+	if (!write_series_deltas(&sizing, series)) {
+		return false;
+	}
+
+	if (!pb_encode_tag(stream, PB_WT_STRING, field->tag)) {
+		return false;
+	}
+
+	if (!pb_encode_varint(stream, sizing.bytes_written)) {
+		return false;
+	}
+
+	return write_series_deltas(stream, series);
+}
+
+static void motor_stream_timeout(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	if (stream_enable) {
+		LOG_WRN("Motor state subscription not renewed in %d ms, stopping",
+			CONFIG_HW75_USB_COMM_MOTOR_STREAM_TIMEOUT_MS);
+		stream_enable = false;
+		motor_trace_stop(motor);
+	}
+}
+
+static K_WORK_DELAYABLE_DEFINE(motor_stream_timeout_work, motor_stream_timeout);
+
+static bool handle_motor_subscribe_state(const usb_comm_MessageH2D *h2d, usb_comm_MessageD2H *d2h,
+					 const void *bytes, uint32_t bytes_len)
+{
+	const usb_comm_MotorSubscription *req = &h2d->payload.motor_subscription;
+	usb_comm_MotorSubscription *res = &d2h->payload.motor_subscription;
+	uint32_t decimation = req->has_decimation ? req->decimation : 1;
+
+	if (!motor) {
+		return false;
+	}
+
+	if (req->enable) {
+		// Renewing the subscription keeps the samples not pushed yet
+		if (!stream_enable || decimation != stream_decimation) {
+			if (motor_trace_start(motor, decimation) != 0) {
+				return false;
+			}
+			stream_dropped = 0;
+		}
+		k_work_reschedule(&motor_stream_timeout_work,
+				  K_MSEC(CONFIG_HW75_USB_COMM_MOTOR_STREAM_TIMEOUT_MS));
+	} else {
+		k_work_cancel_delayable(&motor_stream_timeout_work);
+		motor_trace_stop(motor);
+	}
+
+	stream_enable = req->enable;
+	stream_decimation = decimation;
+
+	res->enable = stream_enable;
+	res->decimation = decimation;
+	res->has_decimation = true;
+	res->timeout_ms = CONFIG_HW75_USB_COMM_MOTOR_STREAM_TIMEOUT_MS;
+	res->has_timeout_ms = true;
+
+	return true;
+}
+
+USB_COMM_HANDLER_DEFINE(usb_comm_Action_MOTOR_SUBSCRIBE_STATE,
+			usb_comm_MessageD2H_motor_subscription_tag, handle_motor_subscribe_state);
+
+static bool motor_stream_active(void)
+{
+	return stream_enable;
+}
+
+static bool motor_stream_poll(usb_comm_MessageD2H *d2h)
+{
+	usb_comm_MotorStateBatch *res = &d2h->payload.motor_state_batch;
+	uint32_t dropped = 0;
+
+	stream_count = motor_trace_read(motor, stream_states, ARRAY_SIZE(stream_states),
+					&dropped);
+	stream_dropped += dropped;
+	if (stream_count <= 0) {
+		return false;
+	}
+
+	res->dropped = stream_dropped;
+	stream_dropped = 0;
+
+	res->timestamp = stream_states[0].timestamp;
+	res->timestamp_delta.funcs.encode = write_series;
+	res->timestamp_delta.arg = (void *)series_timestamp;
+	res->control_mode.funcs.encode = write_series;
+	res->control_mode.arg = (void *)series_control_mode;
+	res->current_angle.funcs.encode = write_series;
+	res->current_angle.arg = (void *)series_current_angle;
+	res->current_velocity.funcs.encode = write_series;
+	res->current_velocity.arg = (void *)series_current_velocity;
+	res->target_angle.funcs.encode = write_series;
+	res->target_angle.arg = (void *)series_target_angle;
+	res->target_velocity.funcs.encode = write_series;
+	res->target_velocity.arg = (void *)series_target_velocity;
+	res->target_voltage.funcs.encode = write_series;
+	res->target_voltage.arg = (void *)series_target_voltage;
+
+	return true;
+}
+
+USB_COMM_STREAM_DEFINE(usb_comm_Action_MOTOR_STATE_STREAM,
+		       usb_comm_MessageD2H_motor_state_batch_tag, motor_stream_active,
+		       motor_stream_poll);
+#endif /* CONFIG_HW75_USB_COMM_MOTOR_STREAM */
+
+#ifdef CONFIG_HW75_USB_COMM_MOTOR_ANTICOGGING
+static int16_t anticogging[MOTOR_ANTICOGGING_SIZE];
+
+static bool write_anticogging_values(pb_ostream_t *stream)
+{
+	for (int i = 0; i < MOTOR_ANTICOGGING_SIZE; i++) {
+		if (!pb_encode_svarint(stream, anticogging[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool write_anticogging(pb_ostream_t *stream, const pb_field_t *field, void *const *arg)
+{
+	pb_ostream_t sizing = PB_OSTREAM_SIZING;
+
+	if (!write_anticogging_values(&sizing)) {
+		return false;
+	}
+
+	if (!pb_encode_tag(stream, PB_WT_STRING, field->tag)) {
+		return false;
+	}
+
+	if (!pb_encode_varint(stream, sizing.bytes_written)) {
+		return false;
+	}
+
+	return write_anticogging_values(stream);
+}
+
+static usb_comm_MotorAnticogging_Status anticogging_status(int ret)
+{
+	switch (ret) {
+	case 0:
+		return usb_comm_MotorAnticogging_Status_OK;
+	case -EINVAL:
+		return usb_comm_MotorAnticogging_Status_NOT_CALIBRATED;
+	case -EBUSY:
+		return usb_comm_MotorAnticogging_Status_BUSY;
+	default:
+		return usb_comm_MotorAnticogging_Status_ERROR;
+	}
+}
+
+static bool handle_motor_anticogging(const usb_comm_MessageH2D *h2d, usb_comm_MessageD2H *d2h,
+				     const void *bytes, uint32_t bytes_len)
+{
+	const usb_comm_MotorAnticogging *req = &h2d->payload.motor_anticogging;
+	usb_comm_MotorAnticogging *res = &d2h->payload.motor_anticogging;
+
+	if (!motor) {
+		return false;
+	}
+
+	if (req->has_clear && req->clear) {
+		res->has_status = true;
+		res->status = anticogging_status(knob_app_clear_anticogging());
+	} else if (req->has_calibrate && req->calibrate) {
+		res->has_status = true;
+		res->status = anticogging_status(knob_app_calibrate_anticogging());
+	}
+
+	res->has_state = true;
+	res->state = (usb_comm_MotorAnticogging_State)knob_app_get_anticogging();
+
+	if (res->state == usb_comm_MotorAnticogging_State_READY &&
+	    motor_anticogging_get(motor, anticogging) == 0) {
+		res->voltages.funcs.encode = write_anticogging;
+	}
+
+	return true;
+}
+
+USB_COMM_HANDLER_DEFINE(usb_comm_Action_MOTOR_ANTICOGGING,
+			usb_comm_MessageD2H_motor_anticogging_tag, handle_motor_anticogging);
+#endif /* CONFIG_HW75_USB_COMM_MOTOR_ANTICOGGING */
+
 static bool write_string(pb_ostream_t *stream, const pb_field_t *field, void *const *arg)
 {
 	char *str = *arg;
@@ -128,6 +388,9 @@ static bool handle_knob_set_config(const usb_comm_MessageH2D *h2d, usb_comm_Mess
 
 	if (req->demo) {
 		knob_app_set_demo(true);
+		if (!knob_app_get_demo()) {
+			return false;
+		}
 		knob_set_mode(knob, (enum knob_mode)req->mode);
 		if (req->mode == usb_comm_KnobConfig_Mode_DAMPED) {
 			knob_set_position_limit(knob, DEG(110.0f), DEG(250.0f));
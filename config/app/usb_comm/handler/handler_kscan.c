@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "handler.h"
+#include "usb_comm.pb.h"
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/kscan/kscan_74hc165.h>
+
+#define KSCAN_NODE DT_CHOSEN(zmk_kscan)
+
+static const struct device *kscan = DEVICE_DT_GET(KSCAN_NODE);
+
+static bool handle_kscan_get_stats(const usb_comm_MessageH2D *h2d, usb_comm_MessageD2H *d2h,
+				   const void *bytes, uint32_t bytes_len)
+{
+	usb_comm_KscanStats *res = &d2h->payload.kscan_stats;
+	struct kscan_74hc165_stats stats;
+
+	kscan_74hc165_get_stats(kscan, &stats);
+
+	res->scans = stats.scans;
+	res->idle_scans = stats.idle_scans;
+	res->scans_per_second = stats.scans_per_second;
+	res->period_ms = stats.period_ms;
+
+	return true;
+}
+
+USB_COMM_HANDLER_DEFINE(usb_comm_Action_KSCAN_GET_STATS, usb_comm_MessageD2H_kscan_stats_tag,
+			handle_kscan_get_stats);
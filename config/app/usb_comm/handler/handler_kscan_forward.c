@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "handler.h"
+#include "usb_comm.pb.h"
+
+#include <zephyr/kernel.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <uart_comm/uart_comm.h>
+
+static bool handle_kscan_get_stats(const usb_comm_MessageH2D *h2d, usb_comm_MessageD2H *d2h,
+				   const void *bytes, uint32_t bytes_len)
+{
+	usb_comm_KscanStats *res = &d2h->payload.kscan_stats;
+	uart_comm_MessageD2K d2k = uart_comm_MessageD2K_init_zero;
+	uart_comm_MessageK2D k2d = uart_comm_MessageK2D_init_zero;
+
+	d2k.action = uart_comm_Action_KSCAN_GET_STATS;
+	d2k.which_payload = uart_comm_MessageD2K_nop_tag;
+
+	int ret = uart_comm_request(&d2k, &k2d,
+				    K_MSEC(CONFIG_HW75_USB_COMM_KSCAN_FORWARD_TIMEOUT_MS));
+	if (ret != 0 || k2d.which_payload != uart_comm_MessageK2D_kscan_stats_tag) {
+		LOG_ERR("Failed getting kscan stats from keyboard: %d", ret);
+		return false;
+	}
+
+	res->scans = k2d.payload.kscan_stats.scans;
+	res->idle_scans = k2d.payload.kscan_stats.idle_scans;
+	res->scans_per_second = k2d.payload.kscan_stats.scans_per_second;
+	res->period_ms = k2d.payload.kscan_stats.period_ms;
+
+	return true;
+}
+
+// Waits for the keyboard, which must not hold up other requests
+USB_COMM_HANDLER_DEFINE_COST(usb_comm_Action_KSCAN_GET_STATS, usb_comm_MessageD2H_kscan_stats_tag,
+			     handle_kscan_get_stats, USB_COMM_HANDLER_SLOW);
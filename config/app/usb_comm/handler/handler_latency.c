@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "handler.h"
+#include "usb_comm.pb.h"
+
+#include <pb_encode.h>
+
+static bool write_bucket_values(pb_ostream_t *stream, const struct usb_comm_latency *latency)
+{
+	for (int i = 0; i < USB_COMM_LATENCY_BUCKETS; i++) {
+		if (!pb_encode_varint(stream, latency->buckets[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool write_buckets(pb_ostream_t *stream, const pb_field_t *field, void *const *arg)
+{
+	const struct usb_comm_latency *latency = *arg;
+	pb_ostream_t sizing = PB_OSTREAM_SIZING;
+
+	if (!write_bucket_values(&sizing, latency)) {
+		return false;
+	}
+
+	if (!pb_encode_tag(stream, PB_WT_STRING, field->tag)) {
+		return false;
+	}
+
+	if (!pb_encode_varint(stream, sizing.bytes_written)) {
+		return false;
+	}
+
+	return write_bucket_values(stream, latency);
+}
+
+static bool handle_get_latency(const usb_comm_MessageH2D *h2d, usb_comm_MessageD2H *d2h,
+			       const void *bytes, uint32_t bytes_len)
+{
+	const usb_comm_HandlerLatency *req = &h2d->payload.handler_latency;
+	usb_comm_HandlerLatency *res = &d2h->payload.handler_latency;
+	static struct usb_comm_latency latency;
+
+	if (usb_comm_get_latency(req->target, &latency, req->has_reset && req->reset) != 0) {
+		return false;
+	}
+
+	const struct usb_comm_handler_config *handler = usb_comm_handler_find(req->target);
+
+	res->target = req->target;
+	res->has_deferred = true;
+	res->deferred = handler != NULL && handler->cost == USB_COMM_HANDLER_SLOW &&
+			IS_ENABLED(CONFIG_HW75_USB_COMM_WORKER);
+	res->has_count = true;
+	res->count = latency.count;
+	res->has_max_us = true;
+	res->max_us = latency.max_us;
+	res->buckets.funcs.encode = write_buckets;
+	res->buckets.arg = &latency;
+
+	return true;
+}
+
+USB_COMM_HANDLER_DEFINE(usb_comm_Action_GET_LATENCY, usb_comm_MessageD2H_handler_latency_tag,
+			handle_get_latency);
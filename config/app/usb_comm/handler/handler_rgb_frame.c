@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "handler.h"
+#include "usb_comm.pb.h"
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/led_strip.h>
+#include <zephyr/drivers/led_strip_remap.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#define STRIP_CHOSEN     DT_CHOSEN(zmk_underglow)
+#define STRIP_NUM_PIXELS DT_PROP(STRIP_CHOSEN, chain_length)
+
+#define PALETTE_SIZE 16
+
+static const struct device *led_strip = DEVICE_DT_GET(STRIP_CHOSEN);
+
+static K_MUTEX_DEFINE(rgb_frame_lock);
+
+// Slices are decoded into `back`. A completed frame is swapped into `ready`, replacing the one
+// that has not been shown yet, and swapped into `front` when it is pushed to the strip.
+static struct led_rgb rgb_frame_bufs[3][STRIP_NUM_PIXELS];
+static struct led_rgb *back = rgb_frame_bufs[0];
+static struct led_rgb *ready = rgb_frame_bufs[1];
+static struct led_rgb *front = rgb_frame_bufs[2];
+static bool frame_ready = false;
+static uint32_t frames_dropped = 0;
+
+static struct led_rgb palette[PALETTE_SIZE];
+
+static bool host_control = false;
+static int64_t last_present = 0;
+
+static void rgb_frame_present(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	k_mutex_lock(&rgb_frame_lock, K_FOREVER);
+	if (!host_control || !frame_ready) {
+		k_mutex_unlock(&rgb_frame_lock);
+		return;
+	}
+
+	struct led_rgb *tmp = front;
+	front = ready;
+	ready = tmp;
+	frame_ready = false;
+	k_mutex_unlock(&rgb_frame_lock);
+
+	// Only this work touches `front`, so the strip is updated outside the lock. The underglow
+	// keeps running underneath, and its persisted state is left alone.
+	last_present = k_uptime_get();
+	led_strip_remap_override(led_strip, front, STRIP_NUM_PIXELS);
+}
+
+static K_WORK_DELAYABLE_DEFINE(rgb_frame_present_work, rgb_frame_present);
+
+static void rgb_frame_release(void)
+{
+	k_mutex_lock(&rgb_frame_lock, K_FOREVER);
+	if (!host_control) {
+		k_mutex_unlock(&rgb_frame_lock);
+		return;
+	}
+	host_control = false;
+	frame_ready = false;
+	k_mutex_unlock(&rgb_frame_lock);
+
+	LOG_DBG("RGB frames released by host");
+
+	// A frame presented after this would take the strip over again
+	struct k_work_sync sync;
+	k_work_cancel_delayable_sync(&rgb_frame_present_work, &sync);
+	led_strip_remap_release(led_strip);
+}
+
+static void rgb_frame_timeout(struct k_work *work)
+{
+	ARG_UNUSED(work);
+	LOG_WRN("No RGB frame from host in %d ms, resuming underglow",
+		CONFIG_HW75_USB_COMM_RGB_FRAME_TIMEOUT_MS);
+	rgb_frame_release();
+}
+
+static K_WORK_DELAYABLE_DEFINE(rgb_frame_timeout_work, rgb_frame_timeout);
+
+static void rgb_frame_acquire(void)
+{
+	if (host_control) {
+		return;
+	}
+
+	k_mutex_lock(&rgb_frame_lock, K_FOREVER);
+	memset(rgb_frame_bufs, 0, sizeof(rgb_frame_bufs));
+	host_control = true;
+	frame_ready = false;
+	k_mutex_unlock(&rgb_frame_lock);
+
+	LOG_DBG("RGB frames taken over by host");
+}
+
+static inline struct led_rgb rgb_from_565(uint16_t v)
+{
+	uint8_t r = (v >> 11) & 0x1F, g = (v >> 5) & 0x3F, b = v & 0x1F;
+
+	return (struct led_rgb){
+		.r = (r << 3) | (r >> 2),
+		.g = (g << 2) | (g >> 4),
+		.b = (b << 3) | (b >> 2),
+	};
+}
+
+static int rgb_frame_decode(const usb_comm_RgbFrame *req, const uint8_t *bytes, uint32_t len)
+{
+	uint32_t offset = req->has_offset ? req->offset : 0;
+
+	if (offset >= STRIP_NUM_PIXELS) {
+		return -EINVAL;
+	}
+
+	uint32_t count = STRIP_NUM_PIXELS - offset;
+	struct led_rgb *pixels = back + offset;
+
+	if (!req->has_format || req->format == usb_comm_RgbFrame_Format_RGB565) {
+		if (len % 2 || len / 2 > count) {
+			return -EINVAL;
+		}
+		for (uint32_t i = 0; i < len / 2; i++) {
+			pixels[i] = rgb_from_565(sys_get_le16(bytes + i * 2));
+		}
+		return 0;
+	}
+
+	if (req->has_palette_size) {
+		if (req->palette_size > PALETTE_SIZE || len < req->palette_size * 3) {
+			return -EINVAL;
+		}
+		for (uint32_t i = 0; i < req->palette_size; i++, bytes += 3) {
+			palette[i] = (struct led_rgb){.r = bytes[0], .g = bytes[1], .b = bytes[2]};
+		}
+		len -= req->palette_size * 3;
+	}
+
+	// The high nibble of the last byte is padding if the slice has an odd number of LEDs
+	if (len > (count + 1) / 2) {
+		return -EINVAL;
+	}
+	count = MIN(count, len * 2);
+	for (uint32_t i = 0; i < count; i++) {
+		pixels[i] = palette[(bytes[i / 2] >> ((i % 2) * 4)) & 0x0F];
+	}
+
+	return 0;
+}
+
+static void rgb_frame_commit(void)
+{
+	k_mutex_lock(&rgb_frame_lock, K_FOREVER);
+	struct led_rgb *tmp = ready;
+	ready = back;
+	back = tmp;
+	if (frame_ready) {
+		frames_dropped++;
+	}
+	frame_ready = true;
+	// Slices of the next frame only overwrite the LEDs they carry
+	memcpy(back, ready, sizeof(rgb_frame_bufs[0]));
+	k_mutex_unlock(&rgb_frame_lock);
+
+	int64_t delay = last_present + CONFIG_HW75_USB_COMM_RGB_FRAME_PERIOD_MS - k_uptime_get();
+	k_work_schedule(&rgb_frame_present_work, K_MSEC(MAX(delay, 0)));
+}
+
+static bool handle_rgb_set_frame(const usb_comm_MessageH2D *h2d, usb_comm_MessageD2H *d2h,
+				 const void *bytes, uint32_t bytes_len)
+{
+	const usb_comm_RgbFrame *req = &h2d->payload.rgb_frame;
+	usb_comm_RgbFrameAck *res = &d2h->payload.rgb_frame_ack;
+
+	res->id = req->id;
+
+	if (req->has_release && req->release) {
+		k_work_cancel_delayable(&rgb_frame_timeout_work);
+		rgb_frame_release();
+		res->dropped = frames_dropped;
+		return true;
+	}
+
+	rgb_frame_acquire();
+	k_work_reschedule(&rgb_frame_timeout_work, K_MSEC(CONFIG_HW75_USB_COMM_RGB_FRAME_TIMEOUT_MS));
+
+	int ret = rgb_frame_decode(req, bytes, bytes_len);
+	if (ret < 0) {
+		LOG_ERR("Invalid RGB frame %u at offset %u, %u bytes", req->id, req->offset,
+			bytes_len);
+		return false;
+	}
+
+	if (!req->has_last || req->last) {
+		rgb_frame_commit();
+	}
+
+	res->dropped = frames_dropped;
+	return true;
+}
+
+USB_COMM_HANDLER_DEFINE(usb_comm_Action_RGB_SET_FRAME, usb_comm_MessageD2H_rgb_frame_ack_tag,
+			handle_rgb_set_frame);
@@ -50,14 +50,22 @@ static bool handle_version(const usb_comm_MessageH2D *h2d, usb_comm_MessageD2H *
 
 	res->has_features = true;
 
+	res->features.has_transport_window = true;
+	res->features.transport_window = CONFIG_HW75_USB_COMM_RX_WINDOW;
+
 #ifdef CONFIG_HW75_USB_COMM_FEATURE_RGB
 	res->features.has_rgb = res->features.rgb = true;
 	res->features.has_rgb_full_control = res->features.rgb_full_control = true;
 	res->features.has_rgb_indicator = res->features.rgb_indicator = true;
 #endif // CONFIG_HW75_USB_COMM_FEATURE_RGB
 
+#ifdef CONFIG_HW75_USB_COMM_RGB_FRAME
+	res->features.has_rgb_frame = res->features.rgb_frame = true;
+#endif // CONFIG_HW75_USB_COMM_RGB_FRAME
+
 #ifdef CONFIG_HW75_USB_COMM_FEATURE_EINK
 	res->features.has_eink = res->features.eink = true;
+	res->features.has_eink_encoding = res->features.eink_encoding = true;
 #endif // CONFIG_HW75_USB_COMM_FEATURE_EINK
 
 #ifdef CONFIG_HW75_USB_COMM_FEATURE_KNOB
@@ -65,6 +73,22 @@ static bool handle_version(const usb_comm_MessageH2D *h2d, usb_comm_MessageD2H *
 	res->features.has_knob_prefs = res->features.knob_prefs = true;
 #endif // CONFIG_HW75_USB_COMM_FEATURE_KNOB
 
+#if defined(CONFIG_HW75_USB_COMM_FEATURE_KSCAN) || defined(CONFIG_HW75_USB_COMM_KSCAN_FORWARD)
+	res->features.has_kscan_stats = res->features.kscan_stats = true;
+#endif // CONFIG_HW75_USB_COMM_FEATURE_KSCAN || CONFIG_HW75_USB_COMM_KSCAN_FORWARD
+
+#ifdef CONFIG_HW75_USB_COMM_MOTOR_STREAM
+	res->features.has_motor_state_stream = res->features.motor_state_stream = true;
+#endif // CONFIG_HW75_USB_COMM_MOTOR_STREAM
+
+#ifdef CONFIG_HW75_USB_COMM_MOTOR_ANTICOGGING
+	res->features.has_motor_anticogging = res->features.motor_anticogging = true;
+#endif // CONFIG_HW75_USB_COMM_MOTOR_ANTICOGGING
+
+#ifdef CONFIG_HW75_USB_COMM_LATENCY_STATS
+	res->features.has_handler_latency = res->features.handler_latency = true;
+#endif // CONFIG_HW75_USB_COMM_LATENCY_STATS
+
 #if DT_HAS_COMPAT_STATUS_OKAY(zmk_knob_profile_switch)
 	res->features.has_knob_profile_switch = res->features.knob_profile_switch = true;
 #endif // DT_HAS_COMPAT_STATUS_OKAY(zmk_knob_profile_switch)
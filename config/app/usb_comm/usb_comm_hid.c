@@ -15,13 +15,18 @@ LOG_MODULE_REGISTER(usb_comm, CONFIG_HW75_USB_COMM_LOG_LEVEL);
 #include "usb_comm_hid.h"
 
 #define HID_COMM_REPORT_ID (1)
-#define HID_COMM_REPORT_COUNT (63)
+#define HID_COMM_REPORT_COUNT USB_COMM_HID_REPORT_SIZE
 
 static const struct device *hid_dev;
 static usb_comm_receive_callback_t receive_callback;
 
 static K_SEM_DEFINE(hid_sem, 1, 1);
 
+// Replies from the worker and ACK/NACK from the usb_comm thread are written concurrently, every
+// report goes through tx_buf under this lock until the endpoint has taken it
+static K_MUTEX_DEFINE(hid_tx_lock);
+static uint8_t tx_buf[HID_COMM_REPORT_COUNT + 1];
+
 #define HID_USAGE_PAGE_VENDOR_DEFINED(page)                                                        \
 	HID_ITEM(HID_ITEM_TAG_USAGE_PAGE, HID_ITEM_TYPE_GLOBAL, 2), page, 0xFF
 
@@ -85,43 +90,40 @@ int usb_comm_hid_init(usb_comm_receive_callback_t callback)
 	return usb_hid_init(hid_dev);
 }
 
-int usb_comm_hid_send(uint8_t *data, uint32_t len)
+int usb_comm_hid_send(const uint8_t *data, uint32_t len)
 {
 	int ret;
 
-	LOG_DBG("message size %u", len);
-	LOG_HEXDUMP_DBG(data, MIN(len, 64), "message data");
+	uint32_t written;
 
-	static uint8_t tx_buf[HID_COMM_REPORT_COUNT + 1];
-	uint32_t tx_len;
+	if (len > HID_COMM_REPORT_COUNT) {
+		LOG_ERR("Report size %u exceeds %u", len, HID_COMM_REPORT_COUNT);
+		return -EINVAL;
+	}
 
-	uint32_t written;
+	k_mutex_lock(&hid_tx_lock, K_FOREVER);
 
 	tx_buf[0] = HID_COMM_REPORT_ID;
-	do {
-		tx_len = MIN(HID_COMM_REPORT_COUNT - 1, len);
-		tx_buf[1] = tx_len & 0xFF;
-		memcpy(tx_buf + 2, data, tx_len);
-		data += tx_len;
-		len -= tx_len;
-
-		k_sem_take(&hid_sem, K_MSEC(30));
-
-		LOG_DBG("packet size %u", sizeof(tx_buf));
-		LOG_HEXDUMP_DBG(tx_buf, sizeof(tx_buf), "packet data");
-
-		ret = hid_int_ep_write(hid_dev, tx_buf, sizeof(tx_buf), &written);
-		if (ret != 0) {
-			k_sem_give(&hid_sem);
-			LOG_ERR("HID write failed: %d", ret);
-			return ret;
-		}
-		if (written != sizeof(tx_buf)) {
-			LOG_ERR("HID write corrupted, requested %u, sent %u", sizeof(tx_buf),
-				written);
-			return -EIO;
-		}
-	} while (len);
+	memcpy(tx_buf + 1, data, len);
+	memset(tx_buf + 1 + len, 0, HID_COMM_REPORT_COUNT - len);
+
+	k_sem_take(&hid_sem, K_MSEC(30));
+
+	LOG_DBG("packet size %u", sizeof(tx_buf));
+	LOG_HEXDUMP_DBG(tx_buf, sizeof(tx_buf), "packet data");
+
+	ret = hid_int_ep_write(hid_dev, tx_buf, sizeof(tx_buf), &written);
+	k_mutex_unlock(&hid_tx_lock);
+
+	if (ret != 0) {
+		k_sem_give(&hid_sem);
+		LOG_ERR("HID write failed: %d", ret);
+		return ret;
+	}
+	if (written != sizeof(tx_buf)) {
+		LOG_ERR("HID write corrupted, requested %u, sent %u", sizeof(tx_buf), written);
+		return -EIO;
+	}
 
 	return 0;
 }
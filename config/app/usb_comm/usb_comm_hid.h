@@ -7,7 +7,9 @@
 
 #include <stdint.h>
 
+#define USB_COMM_HID_REPORT_SIZE (63)
+
 typedef void (*usb_comm_receive_callback_t)(uint8_t *data, uint32_t len);
 
 int usb_comm_hid_init(usb_comm_receive_callback_t callback);
-int usb_comm_hid_send(uint8_t *data, uint32_t len);
+int usb_comm_hid_send(const uint8_t *data, uint32_t len);
@@ -3,6 +3,8 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <string.h>
+
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
 
@@ -14,21 +16,38 @@ LOG_MODULE_DECLARE(usb_comm, CONFIG_HW75_USB_COMM_LOG_LEVEL);
 #include <pb_encode.h>
 #include <pb_decode.h>
 
-#include "usb_comm_hid.h"
+#include "usb_comm_transport.h"
 #include "usb_comm.pb.h"
 
 #include "handler/handler.h"
 
-static struct k_sem usb_comm_sem;
-
 static K_THREAD_STACK_DEFINE(usb_comm_thread_stack, CONFIG_HW75_USB_COMM_THREAD_STACK_SIZE);
 static struct k_thread usb_comm_thread;
 
-static uint32_t usb_rx_idx, usb_rx_len;
-static uint8_t usb_rx_buf[CONFIG_HW75_USB_COMM_MAX_RX_MESSAGE_SIZE];
 static uint8_t usb_tx_buf[CONFIG_HW75_USB_COMM_MAX_TX_MESSAGE_SIZE];
+static K_MUTEX_DEFINE(usb_tx_lock);
+
+#ifdef CONFIG_HW75_USB_COMM_WORKER
+static K_THREAD_STACK_DEFINE(usb_comm_work_stack, CONFIG_HW75_USB_COMM_WORKER_STACK_SIZE);
+static struct k_work_q usb_comm_work_q;
+#endif
+
+struct usb_comm_request {
+	struct usb_comm_transport_message msg;
+	usb_comm_MessageH2D h2d;
+	const struct usb_comm_handler_config *handler;
+	const void *bytes;
+	uint32_t bytes_len;
+	uint32_t start;
+#ifdef CONFIG_HW75_USB_COMM_WORKER
+	struct k_work work;
+#endif
+};
 
-static uint8_t bytes_field[CONFIG_HW75_USB_COMM_MAX_BYTES_FIELD_SIZE];
+// A request stays in its RX slot until the response is sent, so there is one per slot
+static struct usb_comm_request usb_comm_requests[CONFIG_HW75_USB_COMM_RX_WINDOW];
+
+static const uint8_t *bytes_field = NULL;
 static uint32_t bytes_field_len = 0;
 
 #if CONFIG_HW75_USB_COMM_MAX_BYTES_FIELD_SIZE
@@ -37,18 +56,22 @@ static bool read_bytes_field(pb_istream_t *stream, const pb_field_t *field, void
 	ARG_UNUSED(field);
 	ARG_UNUSED(arg);
 
-	if (stream->bytes_left > sizeof(bytes_field)) {
+	if (stream->bytes_left > CONFIG_HW75_USB_COMM_MAX_BYTES_FIELD_SIZE) {
 		LOG_ERR("Buffer overflows decoding %d bytes", stream->bytes_left);
 		return false;
 	}
 
+	// The message is decoded from its RX slot, which is not released until the response is
+	// sent, so the field is referenced in place rather than copied out.
+	const uint8_t *bytes = stream->state;
 	uint32_t bytes_len = stream->bytes_left;
 
-	if (!pb_read(stream, bytes_field, stream->bytes_left)) {
+	if (!pb_read(stream, NULL, stream->bytes_left)) {
 		LOG_ERR("Failed decoding bytes: %s", stream->errmsg);
 		return false;
 	}
 
+	bytes_field = bytes;
 	bytes_field_len = bytes_len;
 	LOG_DBG("Decoded %d bytes", bytes_field_len);
 
@@ -62,89 +85,233 @@ static bool h2d_callback(pb_istream_t *stream, const pb_field_t *field, void **a
 	if (field->tag == usb_comm_MessageH2D_eink_image_tag) {
 		usb_comm_EinkImage *eink_image = field->pData;
 		eink_image->bits.funcs.decode = read_bytes_field;
+	} else if (field->tag == usb_comm_MessageH2D_rgb_frame_tag) {
+		usb_comm_RgbFrame *rgb_frame = field->pData;
+		rgb_frame->pixels.funcs.decode = read_bytes_field;
 	}
 	return true;
 }
 #endif
 
-static void usb_comm_handle_message()
+#ifdef CONFIG_HW75_USB_COMM_LATENCY_STATS
+static struct usb_comm_latency usb_comm_latency[_usb_comm_Action_ARRAYSIZE];
+static struct k_spinlock usb_comm_latency_lock;
+
+static void usb_comm_record_latency(usb_comm_Action action, uint32_t start)
 {
-	LOG_DBG("message size %u", usb_rx_len);
-	LOG_HEXDUMP_DBG(usb_rx_buf, MIN(usb_rx_len, 64), "message data");
+	if ((uint32_t)action >= ARRAY_SIZE(usb_comm_latency)) {
+		return;
+	}
 
-	pb_istream_t h2d_stream = pb_istream_from_buffer(usb_rx_buf, usb_rx_len);
-	pb_ostream_t d2h_stream = pb_ostream_from_buffer(usb_tx_buf, sizeof(usb_tx_buf));
+	uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+	int bucket = 0;
+	while (bucket < USB_COMM_LATENCY_BUCKETS - 1 && us >= (USB_COMM_LATENCY_BASE_US << bucket)) {
+		bucket++;
+	}
 
-	usb_comm_MessageH2D h2d = usb_comm_MessageH2D_init_zero;
-	usb_comm_MessageD2H d2h = usb_comm_MessageD2H_init_zero;
+	k_spinlock_key_t key = k_spin_lock(&usb_comm_latency_lock);
+	struct usb_comm_latency *latency = &usb_comm_latency[action];
+	latency->count++;
+	latency->max_us = MAX(latency->max_us, us);
+	latency->buckets[bucket]++;
+	k_spin_unlock(&usb_comm_latency_lock, key);
+}
 
-#if CONFIG_HW75_USB_COMM_MAX_BYTES_FIELD_SIZE
-	h2d.cb_payload.funcs.decode = h2d_callback;
-#endif
+int usb_comm_get_latency(usb_comm_Action action, struct usb_comm_latency *latency, bool reset)
+{
+	if ((uint32_t)action >= ARRAY_SIZE(usb_comm_latency)) {
+		return -EINVAL;
+	}
 
-	if (!pb_decode_delimited(&h2d_stream, usb_comm_MessageH2D_fields, &h2d)) {
-		LOG_ERR("Failed decoding h2d message: %s", h2d_stream.errmsg);
-		return;
+	k_spinlock_key_t key = k_spin_lock(&usb_comm_latency_lock);
+	*latency = usb_comm_latency[action];
+	if (reset) {
+		memset(&usb_comm_latency[action], 0, sizeof(usb_comm_latency[action]));
 	}
+	k_spin_unlock(&usb_comm_latency_lock, key);
+
+	return 0;
+}
+#else
+static inline void usb_comm_record_latency(usb_comm_Action action, uint32_t start)
+{
+}
 
-	LOG_DBG("req action: %d", h2d.action);
-	d2h.action = h2d.action;
-	d2h.which_payload = usb_comm_MessageD2H_nop_tag;
+int usb_comm_get_latency(usb_comm_Action action, struct usb_comm_latency *latency, bool reset)
+{
+	return -ENOTSUP;
+}
+#endif // CONFIG_HW75_USB_COMM_LATENCY_STATS
+
+// Dense dispatch table indexed by action, built from the handler section at startup
+static const struct usb_comm_handler_config *usb_comm_handler_table[_usb_comm_Action_ARRAYSIZE];
+
+static int usb_comm_handler_table_init(void)
+{
+	int ret = 0;
 
 	STRUCT_SECTION_FOREACH(usb_comm_handler_config, config)
 	{
-		if (config->action == h2d.action) {
-			if (config->handler(&h2d, &d2h, bytes_field, bytes_field_len)) {
-				d2h.which_payload = config->response_payload;
-			}
-			break;
+		if ((uint32_t)config->action >= ARRAY_SIZE(usb_comm_handler_table)) {
+			LOG_ERR("Handler action %d out of range", config->action);
+			ret = -EINVAL;
+			continue;
 		}
+		if (usb_comm_handler_table[config->action] != NULL) {
+			LOG_ERR("Duplicated handlers for action %d", config->action);
+			ret = -EEXIST;
+			continue;
+		}
+		usb_comm_handler_table[config->action] = config;
 	}
 
+	__ASSERT(ret == 0, "Invalid usb_comm handlers: %d", ret);
+
+	return ret;
+}
+
+const struct usb_comm_handler_config *usb_comm_handler_find(usb_comm_Action action)
+{
+	if ((uint32_t)action >= ARRAY_SIZE(usb_comm_handler_table)) {
+		return NULL;
+	}
+
+	return usb_comm_handler_table[action];
+}
+
+static void usb_comm_send_message(const struct usb_comm_transport_message *req,
+				  usb_comm_MessageD2H *d2h)
+{
+	// Responses of the worker and the usb_comm thread share the TX buffer
+	k_mutex_lock(&usb_tx_lock, K_FOREVER);
+	pb_ostream_t d2h_stream = pb_ostream_from_buffer(usb_tx_buf, sizeof(usb_tx_buf));
+
 	size_t d2h_size;
-	pb_get_encoded_size(&d2h_size, usb_comm_MessageD2H_fields, &d2h);
+	pb_get_encoded_size(&d2h_size, usb_comm_MessageD2H_fields, d2h);
 	if (d2h_size > sizeof(usb_tx_buf)) {
 		LOG_ERR("The size of response for action %d is %d, exceeds max tx buf size %d",
-			h2d.action, d2h_size, sizeof(usb_tx_buf));
+			d2h->action, d2h_size, sizeof(usb_tx_buf));
 	}
 
-	if (!pb_encode_delimited(&d2h_stream, usb_comm_MessageD2H_fields, &d2h)) {
+	if (!pb_encode_delimited(&d2h_stream, usb_comm_MessageD2H_fields, d2h)) {
 		LOG_ERR("Failed encoding d2h message: %s", d2h_stream.errmsg);
+		k_mutex_unlock(&usb_tx_lock);
 		return;
 	}
 
-	usb_comm_hid_send(usb_tx_buf, d2h_stream.bytes_written);
+	usb_comm_transport_send(req, usb_tx_buf, d2h_stream.bytes_written);
+	k_mutex_unlock(&usb_tx_lock);
 }
 
-static void usb_comm_handle_packet(uint8_t *data, uint32_t len)
+static void usb_comm_dispatch(struct usb_comm_request *req, usb_comm_MessageD2H *d2h)
 {
-	if (usb_rx_idx + len > sizeof(usb_rx_buf)) {
-		LOG_ERR("RX buffer overflows, index: %d, received: %d", usb_rx_idx, len);
-		usb_rx_idx = 0;
+	LOG_DBG("req action: %d", req->h2d.action);
+	d2h->action = req->h2d.action;
+	d2h->which_payload = usb_comm_MessageD2H_nop_tag;
+
+	if (req->handler != NULL &&
+	    req->handler->handler(&req->h2d, d2h, req->bytes, req->bytes_len)) {
+		d2h->which_payload = req->handler->response_payload;
+	}
+
+	usb_comm_send_message(&req->msg, d2h);
+	usb_comm_record_latency(req->h2d.action, req->start);
+}
+
+#ifdef CONFIG_HW75_USB_COMM_WORKER
+static void usb_comm_work_handler(struct k_work *work)
+{
+	struct usb_comm_request *req = CONTAINER_OF(work, struct usb_comm_request, work);
+	static usb_comm_MessageD2H d2h;
+
+	d2h = (usb_comm_MessageD2H)usb_comm_MessageD2H_init_zero;
+	usb_comm_dispatch(req, &d2h);
+	usb_comm_transport_release(&req->msg);
+}
+#endif
+
+static void usb_comm_handle_message(const struct usb_comm_transport_message *msg, uint32_t start)
+{
+	LOG_DBG("message %d size %u", msg->id, msg->len);
+	LOG_HEXDUMP_DBG(msg->data, MIN(msg->len, 64), "message data");
+
+	struct usb_comm_request *req = &usb_comm_requests[msg->slot];
+	pb_istream_t h2d_stream = pb_istream_from_buffer(msg->data, msg->len);
+
+	req->msg = *msg;
+	req->h2d = (usb_comm_MessageH2D)usb_comm_MessageH2D_init_zero;
+	req->start = start;
+
+	bytes_field = NULL;
+	bytes_field_len = 0;
+
+#if CONFIG_HW75_USB_COMM_MAX_BYTES_FIELD_SIZE
+	req->h2d.cb_payload.funcs.decode = h2d_callback;
+#endif
+
+	if (!pb_decode_delimited(&h2d_stream, usb_comm_MessageH2D_fields, &req->h2d)) {
+		LOG_ERR("Failed decoding h2d message: %s", h2d_stream.errmsg);
+		usb_comm_transport_release(msg);
 		return;
 	}
 
-	if (data[0] + 1 > len) {
-		LOG_ERR("Invalid packet header: %d, len: %d", data[0], len);
+	req->handler = usb_comm_handler_find(req->h2d.action);
+	req->bytes = bytes_field;
+	req->bytes_len = bytes_field_len;
+
+#ifdef CONFIG_HW75_USB_COMM_WORKER
+	// Legacy responses carry no message ID, so they must be sent in order
+	if (req->handler != NULL && req->handler->cost == USB_COMM_HANDLER_SLOW && msg->framed) {
+		k_work_submit_to_queue(&usb_comm_work_q, &req->work);
 		return;
 	}
+#endif
+
+	usb_comm_MessageD2H d2h = usb_comm_MessageD2H_init_zero;
+	usb_comm_dispatch(req, &d2h);
+	usb_comm_transport_release(msg);
+}
+
+static k_timeout_t usb_comm_stream_timeout(void)
+{
+	STRUCT_SECTION_FOREACH(usb_comm_stream_config, config)
+	{
+		if (config->active()) {
+			return K_MSEC(CONFIG_HW75_USB_COMM_STREAM_INTERVAL_MS);
+		}
+	}
 
-	memcpy(usb_rx_buf + usb_rx_idx, data + 1, data[0]);
-	usb_rx_idx += data[0];
+	return K_FOREVER;
+}
 
-	if (data[0] + 1 < len) {
-		usb_rx_len = usb_rx_idx;
-		usb_rx_idx = 0;
-		k_sem_give(&usb_comm_sem);
+static void usb_comm_poll_streams(void)
+{
+	STRUCT_SECTION_FOREACH(usb_comm_stream_config, config)
+	{
+		if (!config->active()) {
+			continue;
+		}
+
+		usb_comm_MessageD2H d2h = usb_comm_MessageD2H_init_zero;
+		d2h.action = config->action;
+		d2h.which_payload = config->payload;
+
+		if (config->poll(&d2h)) {
+			usb_comm_send_message(NULL, &d2h);
+		}
 	}
 }
 
 static void usb_comm_thread_entry(void *p1, void *p2, void *p3)
 {
-	usb_comm_hid_init(usb_comm_handle_packet);
+	struct usb_comm_transport_message msg;
+
+	usb_comm_transport_init();
 	while (true) {
-		k_sem_take(&usb_comm_sem, K_FOREVER);
-		usb_comm_handle_message();
+		if (usb_comm_transport_receive(&msg, usb_comm_stream_timeout()) == 0) {
+			usb_comm_handle_message(&msg, k_cycle_get_32());
+		}
+		usb_comm_poll_streams();
 	}
 }
 
@@ -152,7 +319,17 @@ static int usb_comm_init(const struct device *dev)
 {
 	ARG_UNUSED(dev);
 
-	k_sem_init(&usb_comm_sem, 0, 1);
+	usb_comm_handler_table_init();
+
+#ifdef CONFIG_HW75_USB_COMM_WORKER
+	for (int i = 0; i < ARRAY_SIZE(usb_comm_requests); i++) {
+		k_work_init(&usb_comm_requests[i].work, usb_comm_work_handler);
+	}
+
+	k_work_queue_start(&usb_comm_work_q, usb_comm_work_stack,
+			   K_THREAD_STACK_SIZEOF(usb_comm_work_stack),
+			   CONFIG_HW75_USB_COMM_WORKER_PRIORITY, NULL);
+#endif
 
 	k_thread_create(&usb_comm_thread, usb_comm_thread_stack,
 			CONFIG_HW75_USB_COMM_THREAD_STACK_SIZE, usb_comm_thread_entry, NULL, NULL,
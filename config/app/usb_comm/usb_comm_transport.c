@@ -0,0 +1,416 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/spinlock.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(usb_comm, CONFIG_HW75_USB_COMM_LOG_LEVEL);
+
+#include "usb_comm_hid.h"
+#include "usb_comm_transport.h"
+
+#define LEGACY_CHUNK_SIZE (USB_COMM_HID_REPORT_SIZE - 1)
+#define FRAME_PAYLOAD_SIZE (USB_COMM_HID_REPORT_SIZE - USB_COMM_FRAME_HEADER_SIZE)
+
+#define RX_WINDOW CONFIG_HW75_USB_COMM_RX_WINDOW
+#define RX_NACK_DEPTH (4)
+
+// Every slot starts receiving into a buffer of its own, and a message outgrowing it moves to the
+// one large buffer shared by all slots
+#define RX_LARGE_SIZE CONFIG_HW75_USB_COMM_MAX_RX_MESSAGE_SIZE
+#define RX_SLOT_SIZE MIN(CONFIG_HW75_USB_COMM_RX_SLOT_SIZE, RX_LARGE_SIZE)
+
+BUILD_ASSERT(CONFIG_HW75_USB_COMM_MAX_RX_MESSAGE_SIZE <= FRAME_PAYLOAD_SIZE * 256,
+	     "Message size exceeds the range of fragment sequence numbers");
+BUILD_ASSERT(CONFIG_HW75_USB_COMM_MAX_TX_MESSAGE_SIZE <= FRAME_PAYLOAD_SIZE * 256,
+	     "Message size exceeds the range of fragment sequence numbers");
+
+enum rx_slot_state {
+	RX_SLOT_FREE,
+	RX_SLOT_RECEIVING,
+	RX_SLOT_QUEUED,
+};
+
+struct rx_slot {
+	enum rx_slot_state state;
+	bool framed;
+	bool nacked;
+	uint8_t id;
+	uint8_t seq;
+	uint32_t len;
+	uint8_t *buf;
+	uint32_t size;
+	uint8_t small_buf[RX_SLOT_SIZE];
+};
+
+enum rx_event_type {
+	RX_EVENT_MESSAGE,
+	RX_EVENT_NACK,
+};
+
+struct rx_event {
+	uint8_t type;
+	uint8_t slot;
+	uint8_t id;
+	uint8_t seq;
+	uint8_t reason;
+};
+
+static struct rx_slot rx_slots[RX_WINDOW];
+static struct k_spinlock rx_lock;
+
+#if RX_LARGE_SIZE > RX_SLOT_SIZE
+static uint8_t rx_large_buf[RX_LARGE_SIZE];
+static struct rx_slot *rx_large_owner;
+#endif
+
+// At most one message event per slot can be queued, so they always fit. NACKs only take what
+// is left beyond that.
+K_MSGQ_DEFINE(usb_comm_rx_events, sizeof(struct rx_event), RX_WINDOW + RX_NACK_DEPTH, 1);
+
+static bool host_framed;
+
+static struct rx_slot *rx_slot_find(bool framed, uint8_t id)
+{
+	for (int i = 0; i < RX_WINDOW; i++) {
+		struct rx_slot *slot = &rx_slots[i];
+		if (slot->state == RX_SLOT_RECEIVING && slot->framed == framed && slot->id == id) {
+			return slot;
+		}
+	}
+	return NULL;
+}
+
+static struct rx_slot *rx_slot_alloc(bool framed, uint8_t id)
+{
+	for (int i = 0; i < RX_WINDOW; i++) {
+		struct rx_slot *slot = &rx_slots[i];
+		if (slot->state == RX_SLOT_FREE) {
+			slot->state = RX_SLOT_RECEIVING;
+			slot->framed = framed;
+			slot->nacked = false;
+			slot->id = id;
+			slot->seq = 0;
+			slot->len = 0;
+			slot->buf = slot->small_buf;
+			slot->size = sizeof(slot->small_buf);
+			return slot;
+		}
+	}
+	return NULL;
+}
+
+static void rx_slot_free(struct rx_slot *slot)
+{
+#if RX_LARGE_SIZE > RX_SLOT_SIZE
+	if (rx_large_owner == slot) {
+		rx_large_owner = NULL;
+	}
+#endif
+	slot->state = RX_SLOT_FREE;
+}
+
+// Makes room for `len` more bytes in the slot, moving it to the large buffer if needed
+static bool rx_slot_reserve(struct rx_slot *slot, uint32_t len)
+{
+	if (slot->len + len <= slot->size) {
+		return true;
+	}
+
+#if RX_LARGE_SIZE > RX_SLOT_SIZE
+	if (rx_large_owner == NULL && slot->len + len <= RX_LARGE_SIZE) {
+		memcpy(rx_large_buf, slot->buf, slot->len);
+		slot->buf = rx_large_buf;
+		slot->size = sizeof(rx_large_buf);
+		rx_large_owner = slot;
+		return true;
+	}
+#endif
+
+	return false;
+}
+
+static uint8_t rx_slot_free_count(void)
+{
+	uint8_t count = 0;
+	for (int i = 0; i < RX_WINDOW; i++) {
+		if (rx_slots[i].state == RX_SLOT_FREE) {
+			count++;
+		}
+	}
+	return count;
+}
+
+static void rx_post_message(struct rx_slot *slot)
+{
+	const struct rx_event event = {
+		.type = RX_EVENT_MESSAGE,
+		.slot = slot - rx_slots,
+	};
+
+	slot->state = RX_SLOT_QUEUED;
+	k_msgq_put(&usb_comm_rx_events, &event, K_NO_WAIT);
+}
+
+static void rx_post_nack(uint8_t id, uint8_t seq, enum usb_comm_nack_reason reason)
+{
+	const struct rx_event event = {
+		.type = RX_EVENT_NACK,
+		.id = id,
+		.seq = seq,
+		.reason = reason,
+	};
+
+	if (k_msgq_num_free_get(&usb_comm_rx_events) <= RX_WINDOW) {
+		LOG_DBG("Dropped NACK for message %d, seq %d, reason %d", id, seq, reason);
+		return;
+	}
+
+	k_msgq_put(&usb_comm_rx_events, &event, K_NO_WAIT);
+}
+
+static void usb_comm_transport_handle_legacy(uint8_t *data, uint32_t len)
+{
+	const uint8_t chunk_len = data[0];
+
+	if (chunk_len + 1 > len) {
+		LOG_ERR("Invalid packet header: %d, len: %d", chunk_len, len);
+		return;
+	}
+
+	struct rx_slot *slot = rx_slot_find(false, 0);
+	if (slot == NULL) {
+		slot = rx_slot_alloc(false, 0);
+		if (slot == NULL) {
+			LOG_ERR("No free RX slot, dropping packet");
+			return;
+		}
+	}
+
+	if (!rx_slot_reserve(slot, chunk_len)) {
+		LOG_ERR("RX buffer overflows, index: %d, received: %d", slot->len, chunk_len);
+		rx_slot_free(slot);
+		return;
+	}
+
+	memcpy(slot->buf + slot->len, data + 1, chunk_len);
+	slot->len += chunk_len;
+
+	if (chunk_len + 1 < len) {
+		rx_post_message(slot);
+	}
+}
+
+static void usb_comm_transport_handle_frame(uint8_t *data, uint32_t len)
+{
+	if (len < USB_COMM_FRAME_HEADER_SIZE) {
+		LOG_ERR("Invalid frame length: %d", len);
+		return;
+	}
+
+	const uint8_t type = data[0] & USB_COMM_FRAME_TYPE_MASK;
+	const uint8_t id = data[1];
+	const uint8_t seq = data[2];
+	const uint8_t payload_len = data[3];
+
+	if (type != USB_COMM_FRAME_DATA || payload_len > len - USB_COMM_FRAME_HEADER_SIZE) {
+		LOG_ERR("Invalid frame header: %02x, len: %d", data[0], len);
+		return;
+	}
+
+	host_framed = true;
+
+	struct rx_slot *slot = rx_slot_find(true, id);
+	if (slot == NULL) {
+		if (seq != 0) {
+			rx_post_nack(id, 0, USB_COMM_NACK_SEQUENCE);
+			return;
+		}
+
+		slot = rx_slot_alloc(true, id);
+		if (slot == NULL) {
+			rx_post_nack(id, 0, USB_COMM_NACK_BUSY);
+			return;
+		}
+	}
+
+	if (seq != slot->seq) {
+		// Go back to the expected fragment, and stay quiet about the ones the host has
+		// already sent before seeing the NACK.
+		if (!slot->nacked) {
+			slot->nacked = true;
+			rx_post_nack(id, slot->seq, USB_COMM_NACK_SEQUENCE);
+		}
+		return;
+	}
+
+	slot->nacked = false;
+
+	if (!rx_slot_reserve(slot, payload_len)) {
+		// Too large for any buffer, or the large one is taken by another message
+		const bool busy = slot->len + payload_len <= RX_LARGE_SIZE;
+
+		if (busy) {
+			LOG_DBG("Large RX buffer taken, message %d must wait", id);
+		} else {
+			LOG_ERR("RX buffer overflows, index: %d, received: %d", slot->len,
+				payload_len);
+		}
+		rx_slot_free(slot);
+		rx_post_nack(id, 0, busy ? USB_COMM_NACK_BUSY : USB_COMM_NACK_OVERFLOW);
+		return;
+	}
+
+	memcpy(slot->buf + slot->len, data + USB_COMM_FRAME_HEADER_SIZE, payload_len);
+	slot->len += payload_len;
+	slot->seq++;
+
+	if (data[0] & USB_COMM_FRAME_LAST) {
+		rx_post_message(slot);
+	}
+}
+
+static void usb_comm_transport_handle_report(uint8_t *data, uint32_t len)
+{
+	if (len == 0) {
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&rx_lock);
+
+	if (data[0] & USB_COMM_FRAME_MARKER) {
+		usb_comm_transport_handle_frame(data, len);
+	} else {
+		usb_comm_transport_handle_legacy(data, len);
+	}
+
+	k_spin_unlock(&rx_lock, key);
+}
+
+static int usb_comm_transport_send_control(enum usb_comm_frame_type type, uint8_t id, uint8_t seq,
+					   uint8_t arg)
+{
+	const uint8_t report[] = {
+		USB_COMM_FRAME_MARKER | type, id, seq, sizeof(arg), arg,
+	};
+
+	return usb_comm_hid_send(report, sizeof(report));
+}
+
+static int usb_comm_transport_send_legacy(const uint8_t *data, uint32_t len)
+{
+	uint8_t report[USB_COMM_HID_REPORT_SIZE];
+	uint32_t chunk_len;
+	int ret;
+
+	do {
+		chunk_len = MIN(LEGACY_CHUNK_SIZE, len);
+		report[0] = chunk_len;
+		memcpy(report + 1, data, chunk_len);
+		data += chunk_len;
+		len -= chunk_len;
+
+		ret = usb_comm_hid_send(report, chunk_len + 1);
+		if (ret != 0) {
+			return ret;
+		}
+	} while (len);
+
+	return 0;
+}
+
+static int usb_comm_transport_send_framed(uint8_t id, const uint8_t *data, uint32_t len)
+{
+	uint8_t report[USB_COMM_HID_REPORT_SIZE];
+	uint32_t chunk_len;
+	uint8_t seq = 0;
+	int ret;
+
+	do {
+		chunk_len = MIN(FRAME_PAYLOAD_SIZE, len);
+		len -= chunk_len;
+
+		report[0] = USB_COMM_FRAME_MARKER | USB_COMM_FRAME_DATA |
+			    (len == 0 ? USB_COMM_FRAME_LAST : 0);
+		report[1] = id;
+		report[2] = seq++;
+		report[3] = chunk_len;
+		memcpy(report + USB_COMM_FRAME_HEADER_SIZE, data, chunk_len);
+		data += chunk_len;
+
+		ret = usb_comm_hid_send(report, USB_COMM_FRAME_HEADER_SIZE + chunk_len);
+		if (ret != 0) {
+			return ret;
+		}
+	} while (len);
+
+	return 0;
+}
+
+int usb_comm_transport_receive(struct usb_comm_transport_message *msg, k_timeout_t timeout)
+{
+	struct rx_event event;
+	int ret;
+
+	ret = k_msgq_get(&usb_comm_rx_events, &event, timeout);
+	if (ret != 0) {
+		return ret;
+	}
+
+	if (event.type == RX_EVENT_NACK) {
+		LOG_DBG("NACK message %d, seq %d, reason %d", event.id, event.seq, event.reason);
+		usb_comm_transport_send_control(USB_COMM_FRAME_NACK, event.id, event.seq,
+						event.reason);
+		return -EAGAIN;
+	}
+
+	const struct rx_slot *slot = &rx_slots[event.slot];
+
+	if (slot->framed) {
+		k_spinlock_key_t key = k_spin_lock(&rx_lock);
+		uint8_t window = rx_slot_free_count();
+		k_spin_unlock(&rx_lock, key);
+
+		usb_comm_transport_send_control(USB_COMM_FRAME_ACK, slot->id, slot->seq - 1,
+						window);
+	}
+
+	msg->data = slot->buf;
+	msg->len = slot->len;
+	msg->slot = event.slot;
+	msg->id = slot->id;
+	msg->framed = slot->framed;
+
+	return 0;
+}
+
+void usb_comm_transport_release(const struct usb_comm_transport_message *msg)
+{
+	k_spinlock_key_t key = k_spin_lock(&rx_lock);
+	rx_slot_free(&rx_slots[msg->slot]);
+	k_spin_unlock(&rx_lock, key);
+}
+
+int usb_comm_transport_send(const struct usb_comm_transport_message *req, const uint8_t *data,
+			    uint32_t len)
+{
+	const bool framed = req != NULL ? req->framed : host_framed;
+
+	LOG_DBG("message size %u", len);
+	LOG_HEXDUMP_DBG(data, MIN(len, 64), "message data");
+
+	if (framed) {
+		return usb_comm_transport_send_framed(req != NULL ? req->id : 0, data, len);
+	} else {
+		return usb_comm_transport_send_legacy(data, len);
+	}
+}
+
+int usb_comm_transport_init(void)
+{
+	return usb_comm_hid_init(usb_comm_transport_handle_report);
+}
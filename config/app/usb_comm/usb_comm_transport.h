@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <zephyr/kernel.h>
+
+/*
+ * Every HID report starts with a header byte. Legacy reports carry the length of the chunk in
+ * it (at most 62 bytes), and a chunk that does not fill the report ends the message. Framed
+ * reports set USB_COMM_FRAME_MARKER and are laid out as:
+ *
+ *   [0] marker | flags | type
+ *   [1] message ID, allocated by the host from 1, 0 is reserved for pushed messages
+ *   [2] fragment sequence number, starting from 0 in each message
+ *   [3] payload length
+ *   [4] payload
+ *
+ * The host may keep up to `transport_window` (see Version.Features) messages in flight. Each
+ * complete message is ACKed with the number of free slots as payload, and the response is
+ * sent back with the same message ID. A NACK carries the expected sequence number and a
+ * reason, the host should then resend the message from that fragment.
+ */
+
+#define USB_COMM_FRAME_MARKER BIT(7)
+#define USB_COMM_FRAME_LAST BIT(6)
+#define USB_COMM_FRAME_TYPE_MASK (0x03)
+
+#define USB_COMM_FRAME_HEADER_SIZE (4)
+
+enum usb_comm_frame_type {
+	USB_COMM_FRAME_DATA = 0,
+	USB_COMM_FRAME_ACK = 1,
+	USB_COMM_FRAME_NACK = 2,
+};
+
+enum usb_comm_nack_reason {
+	USB_COMM_NACK_SEQUENCE = 0,
+	USB_COMM_NACK_BUSY = 1,
+	USB_COMM_NACK_OVERFLOW = 2,
+};
+
+struct usb_comm_transport_message {
+	const uint8_t *data;
+	uint32_t len;
+	uint8_t slot;
+	uint8_t id;
+	bool framed;
+};
+
+int usb_comm_transport_init(void);
+
+int usb_comm_transport_receive(struct usb_comm_transport_message *msg, k_timeout_t timeout);
+
+void usb_comm_transport_release(const struct usb_comm_transport_message *msg);
+
+int usb_comm_transport_send(const struct usb_comm_transport_message *req, const uint8_t *data,
+			    uint32_t len);
@@ -5,11 +5,13 @@
 
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
+#include <zephyr/sys/util.h>
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 #include <zephyr/drivers/display.h>
+#include <zephyr/drivers/display/ssd16xx_ext.h>
 
 #include <zmk/event_manager.h>
 #include <app/events/eink_state_changed.h>
@@ -20,61 +22,387 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #define EINK_WIDTH DT_PROP(EINK_NODE, width)
 #define EINK_HEIGHT DT_PROP(EINK_NODE, height)
 
+#define EPD_NODE DT_PHANDLE(EINK_NODE, display)
+
+#define EINK_PITCH (EINK_WIDTH / 8)
+
+#define EINK_APP_THREAD_STACK_SIZE 1024
+#define EINK_APP_THREAD_PRIORITY 12
+
+// Dirty rows closer than this are refreshed as a single window
+#define EINK_DIRTY_MERGE_ROWS 8
+
+BUILD_ASSERT(EINK_PITCH <= 32, "Dirty column mask does not fit in 32 bits");
+
 static const struct device *eink = DEVICE_DT_GET(EINK_NODE);
+static const struct device *epd = DEVICE_DT_GET(EPD_NODE);
+
+K_THREAD_STACK_DEFINE(eink_work_stack_area, EINK_APP_THREAD_STACK_SIZE);
+static struct k_work_q eink_work_q;
+
+static void eink_refresh_work_handler(struct k_work *work);
+static K_WORK_DEFINE(eink_refresh_work, eink_refresh_work_handler);
+
+// Guards everything written by eink_update_region(), which runs on the caller's thread while
+// the refresh runs on eink_work_q
+static K_MUTEX_DEFINE(eink_lock);
+
+// What is on the panel once all pending dirty rows are refreshed, which delta frames are
+// applied to
+static uint8_t eink_frame[EINK_PITCH * EINK_HEIGHT];
+static bool eink_frame_valid = false;
+
+// Byte columns changed in each row and not yet taken by a refresh
+static uint32_t eink_dirty[EINK_HEIGHT];
+
+// Refresh requested by the pending updates, and the pixels they changed
+static enum eink_refresh eink_pending_refresh = EINK_REFRESH_AUTO;
+static uint32_t eink_pending_changed = 0;
+
+// Dirty rows taken by the refresh in progress, only touched by eink_work_q. They are loaded from
+// eink_frame under eink_lock, and new updates are decoded into it while the panel is busy.
+static uint32_t eink_panel_dirty[EINK_HEIGHT];
+
+// Pixels flipped by partial refreshes since the last full refresh
+static uint32_t eink_ghosting = 0;
+static uint32_t eink_partial_count = 0;
 
 ZMK_EVENT_IMPL(app_eink_state_changed);
 
-int eink_update(const uint8_t *image, uint32_t image_len, bool partial)
+struct eink_cursor {
+	uint8_t *row;
+	uint32_t y;
+	uint32_t col;
+	uint32_t col_start;
+	uint32_t col_end;
+	uint32_t changed;
+};
+
+static inline void eink_cursor_put(struct eink_cursor *cur, uint8_t bits, bool xor)
 {
-	return eink_update_region(image, image_len, 0, 0, EINK_WIDTH, EINK_HEIGHT, partial);
+	uint8_t *p = cur->row + cur->col;
+	uint8_t next = xor ? *p ^ bits : bits;
+	uint8_t diff = *p ^ next;
+
+	if (diff) {
+		*p = next;
+		eink_dirty[cur->y] |= BIT(cur->col);
+		cur->changed += __builtin_popcount(diff);
+	}
+
+	if (++cur->col == cur->col_end) {
+		cur->col = cur->col_start;
+		cur->row += EINK_PITCH;
+		cur->y++;
+	}
 }
 
-int eink_update_region(const uint8_t *image, uint32_t image_len, uint32_t x, uint32_t y,
-		       uint32_t width, uint32_t height, bool partial)
+// Decodes the image into its region of eink_frame in a single pass, marking changed bytes as
+// dirty, or only checks that it decodes to exactly the size of the region if dry_run is set.
+// Returns the number of changed pixels.
+static int eink_decode(const uint8_t *image, uint32_t image_len, enum eink_encoding encoding,
+		       uint32_t x, uint32_t y, uint32_t width, uint32_t height, bool dry_run)
 {
-	if (x >= EINK_WIDTH || y >= EINK_HEIGHT || x + width > EINK_WIDTH ||
-	    y + height > EINK_HEIGHT) {
-		LOG_ERR("Invalid partial update region: (%d, %d, %d, %d)", x, y, width, height);
-		return -EINVAL;
+	const uint32_t total = width * height / 8;
+	const bool xor = encoding == EINK_ENCODING_DELTA;
+
+	struct eink_cursor cur = {
+		.row = &eink_frame[y * EINK_PITCH],
+		.y = y,
+		.col = x / 8,
+		.col_start = x / 8,
+		.col_end = (x + width) / 8,
+		.changed = 0,
+	};
+
+	if (encoding == EINK_ENCODING_RAW) {
+		if (image_len != total) {
+			return -EINVAL;
+		}
+		for (uint32_t i = 0; !dry_run && i < image_len; i++) {
+			eink_cursor_put(&cur, image[i], false);
+		}
+		return cur.changed;
 	}
 
-	if (image_len != width * height / 8) {
-		LOG_ERR("Invalid image length: %d", image_len);
-		return -EINVAL;
+	uint32_t in = 0, out = 0;
+
+	while (in < image_len) {
+		const uint8_t c = image[in++];
+		const bool repeat = c & 0x80;
+		const uint32_t run = (c & 0x7f) + 1;
+
+		if (out + run > total || in + (repeat ? 1 : run) > image_len) {
+			return -EINVAL;
+		}
+
+		for (uint32_t i = 0; !dry_run && i < run; i++) {
+			eink_cursor_put(&cur, repeat ? image[in] : image[in + i], xor);
+		}
+
+		in += repeat ? 1 : run;
+		out += run;
 	}
 
-	struct display_buffer_descriptor desc = {
-		.buf_size = image_len,
-		.width = width,
-		.height = height,
-		.pitch = width,
-	};
+	return out == total ? cur.changed : -EINVAL;
+}
 
-	LOG_DBG("Start updating E-Ink");
+static void eink_mark_dirty(uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+	const uint32_t mask = GENMASK((x + width) / 8 - 1, x / 8);
 
-	ZMK_EVENT_RAISE(new_app_eink_state_changed((struct app_eink_state_changed){
-		.busy = true,
-	}));
+	for (uint32_t row = y; row < y + height; row++) {
+		eink_dirty[row] |= mask;
+	}
+}
+
+static bool eink_is_dirty(void)
+{
+	for (uint32_t row = 0; row < EINK_HEIGHT; row++) {
+		if (eink_dirty[row]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Writes the bounding box of every group of rows taken by the refresh, as they are in eink_frame
+static int eink_write_dirty(void)
+{
+	uint32_t row = 0;
+	int ret = 0;
+
+	k_mutex_lock(&eink_lock, K_FOREVER);
+
+	while (row < EINK_HEIGHT) {
+		if (!eink_panel_dirty[row]) {
+			row++;
+			continue;
+		}
+
+		uint32_t start = row, end = row + 1;
+		uint32_t mask = eink_panel_dirty[row];
+
+		for (row++; row < EINK_HEIGHT && row - end < EINK_DIRTY_MERGE_ROWS; row++) {
+			if (eink_panel_dirty[row]) {
+				mask |= eink_panel_dirty[row];
+				end = row + 1;
+			}
+		}
+
+		const uint32_t col = __builtin_ctz(mask);
+		const uint32_t cols = 32 - __builtin_clz(mask) - col;
+		const uint32_t height = end - start;
+
+		const struct display_buffer_descriptor desc = {
+			.buf_size = (height - 1) * EINK_PITCH + cols,
+			.width = cols * 8,
+			.height = height,
+			.pitch = EINK_WIDTH,
+		};
+
+		LOG_DBG("Writing dirty window (%d, %d, %d, %d)", col * 8, start, cols * 8, height);
+
+		ret = display_write(eink, col * 8, start, &desc,
+				    &eink_frame[start * EINK_PITCH + col]);
+		if (ret < 0) {
+			break;
+		}
+
+		row = end;
+	}
+
+	k_mutex_unlock(&eink_lock);
+	return ret;
+}
+
+static bool eink_should_refresh_full(uint32_t changed)
+{
+	if (eink_partial_count + 1 >= CONFIG_HW75_EINK_AUTO_FULL_REFRESH_COUNT) {
+		return true;
+	}
+
+	return (eink_ghosting + changed) * 100 >=
+	       (uint32_t)EINK_WIDTH * EINK_HEIGHT * CONFIG_HW75_EINK_AUTO_FULL_REFRESH_GHOSTING;
+}
+
+static int eink_refresh(bool partial)
+{
+	int ret;
 
 	if (!partial) {
 		display_blanking_on(eink);
 	}
 
-	int ret = display_write(eink, x, y, &desc, image);
-	if (ret != 0) {
-		LOG_ERR("Failed updating E-ink image: %d", ret);
-		return ret;
+	// The dirty windows are rotated and loaded into the controller RAM in chunks, hold back
+	// the refresh until all of them are there.
+	ssd16xx_hold(epd, true);
+
+	ret = eink_write_dirty();
+	if (ret == 0 && partial) {
+		ret = ssd16xx_refresh(epd);
+		if (ret > 0) {
+			// Rows decoded during the refresh may be loaded here already, they are dirty
+			// again and the next partial refresh still starts from what is on the panel
+			ret = ssd16xx_wait(epd);
+			if (ret == 0) {
+				ret = eink_write_dirty();
+			}
+		}
 	}
 
+	ssd16xx_hold(epd, false);
+
 	if (!partial) {
 		display_blanking_off(eink);
 	}
 
+	if (ret == 0) {
+		ret = ssd16xx_wait(epd);
+	}
+
+	return ret;
+}
+
+// Takes all pending updates at once, so that updates queued during a refresh are merged into
+// the next one
+static void eink_refresh_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	k_mutex_lock(&eink_lock, K_FOREVER);
+
+	if (!eink_is_dirty()) {
+		k_mutex_unlock(&eink_lock);
+		return;
+	}
+
+	memcpy(eink_panel_dirty, eink_dirty, sizeof(eink_panel_dirty));
+	memset(eink_dirty, 0, sizeof(eink_dirty));
+
+	const enum eink_refresh refresh = eink_pending_refresh;
+	const uint32_t changed = eink_pending_changed;
+
+	eink_pending_refresh = EINK_REFRESH_AUTO;
+	eink_pending_changed = 0;
+
+	k_mutex_unlock(&eink_lock);
+
+	bool partial;
+	switch (refresh) {
+	case EINK_REFRESH_FULL:
+		partial = false;
+		break;
+	case EINK_REFRESH_PARTIAL:
+		partial = true;
+		break;
+	default:
+		partial = !eink_should_refresh_full(changed);
+		break;
+	}
+
+	LOG_DBG("Start updating E-Ink, %d pixels changed, partial: %d", changed, partial);
+
+	ZMK_EVENT_RAISE(new_app_eink_state_changed((struct app_eink_state_changed){
+		.busy = true,
+	}));
+
+	int ret = eink_refresh(partial);
+	if (ret < 0) {
+		LOG_ERR("Failed updating E-ink image: %d", ret);
+
+		// The panel no longer matches eink_frame
+		k_mutex_lock(&eink_lock, K_FOREVER);
+		eink_frame_valid = false;
+		k_mutex_unlock(&eink_lock);
+	} else if (partial) {
+		eink_ghosting += changed;
+		eink_partial_count++;
+	} else {
+		eink_ghosting = 0;
+		eink_partial_count = 0;
+	}
+
 	ZMK_EVENT_RAISE(new_app_eink_state_changed((struct app_eink_state_changed){
 		.busy = false,
 	}));
 
 	LOG_DBG("E-Ink update finished");
+}
+
+int eink_update(const uint8_t *image, uint32_t image_len, enum eink_encoding encoding,
+		enum eink_refresh refresh)
+{
+	return eink_update_region(image, image_len, encoding, 0, 0, EINK_WIDTH, EINK_HEIGHT,
+				  refresh);
+}
+
+int eink_update_region(const uint8_t *image, uint32_t image_len, enum eink_encoding encoding,
+		       uint32_t x, uint32_t y, uint32_t width, uint32_t height,
+		       enum eink_refresh refresh)
+{
+	// Written so that a huge width or height cannot wrap around
+	if (x >= EINK_WIDTH || y >= EINK_HEIGHT || width == 0 || height == 0 ||
+	    width > EINK_WIDTH - x || height > EINK_HEIGHT - y || x % 8 != 0 || width % 8 != 0) {
+		LOG_ERR("Invalid partial update region: (%d, %d, %d, %d)", x, y, width, height);
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&eink_lock, K_FOREVER);
+
+	int ret;
+
+	if (encoding == EINK_ENCODING_DELTA && !eink_frame_valid) {
+		LOG_ERR("No previous frame to apply delta to");
+		ret = -ENODATA;
+		goto out;
+	}
+
+	ret = eink_decode(image, image_len, encoding, x, y, width, height, true);
+	if (ret < 0) {
+		LOG_ERR("Invalid image, length: %d, encoding: %d", image_len, encoding);
+		goto out;
+	}
+
+	uint32_t changed = eink_decode(image, image_len, encoding, x, y, width, height, false);
+
+	if (!eink_frame_valid) {
+		// Nothing is known about what is on the panel yet
+		eink_mark_dirty(x, y, width, height);
+		changed = width * height;
+		if (width == EINK_WIDTH && height == EINK_HEIGHT) {
+			eink_frame_valid = true;
+		}
+	}
+
+	// A full refresh requested by any of the merged updates wins over a partial one
+	if (refresh == EINK_REFRESH_FULL || eink_pending_refresh == EINK_REFRESH_AUTO) {
+		eink_pending_refresh = refresh;
+	}
+	eink_pending_changed += changed;
+
+	if (eink_is_dirty()) {
+		k_work_submit_to_queue(&eink_work_q, &eink_refresh_work);
+	} else {
+		LOG_DBG("E-Ink unchanged, skipping refresh");
+	}
+
+	ret = 0;
+
+out:
+	k_mutex_unlock(&eink_lock);
+	return ret;
+}
+
+static int eink_app_init(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	k_work_queue_start(&eink_work_q, eink_work_stack_area,
+			   K_THREAD_STACK_SIZEOF(eink_work_stack_area), EINK_APP_THREAD_PRIORITY,
+			   NULL);
 
 	return 0;
 }
+
+SYS_INIT(eink_app_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -8,7 +8,21 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-int eink_update(const uint8_t *image, uint32_t image_len, bool partial);
+enum eink_encoding {
+	EINK_ENCODING_RAW,
+	EINK_ENCODING_RLE,
+	EINK_ENCODING_DELTA,
+};
 
-int eink_update_region(const uint8_t *image, uint32_t image_len, uint32_t x, uint32_t y,
-		       uint32_t width, uint32_t height, bool partial);
+enum eink_refresh {
+	EINK_REFRESH_AUTO,
+	EINK_REFRESH_FULL,
+	EINK_REFRESH_PARTIAL,
+};
+
+int eink_update(const uint8_t *image, uint32_t image_len, enum eink_encoding encoding,
+		enum eink_refresh refresh);
+
+int eink_update_region(const uint8_t *image, uint32_t image_len, enum eink_encoding encoding,
+		       uint32_t x, uint32_t y, uint32_t width, uint32_t height,
+		       enum eink_refresh refresh);
@@ -6,6 +6,7 @@
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
 #include <zephyr/settings/settings.h>
+#include <zephyr/sys/crc.h>
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
@@ -85,6 +86,98 @@ ZMK_EVENT_IMPL(app_knob_state_changed);
 
 static void knob_app_apply_pref(uint8_t layer_id);
 
+#if defined(CONFIG_SETTINGS) && defined(CONFIG_KNOB_MOTOR_ENCODER_COMP)
+static int16_t encoder_comp[MOTOR_ENCODER_COMP_SIZE];
+static bool encoder_comp_loaded = false;
+
+static void knob_app_save_encoder_comp(void)
+{
+	if (encoder_comp_loaded || motor_encoder_comp_get(motor, encoder_comp) != 0) {
+		return;
+	}
+
+	int ret = settings_save_one("app/knob/encoder_comp", encoder_comp, sizeof(encoder_comp));
+	if (ret != 0) {
+		LOG_ERR("Failed saving encoder compensation: %d", ret);
+	} else {
+		encoder_comp_loaded = true;
+		LOG_DBG("Saved encoder compensation");
+	}
+}
+
+// Drop the table and its saved copy, so that the next calibration sweeps the encoder again
+static void knob_app_clear_encoder_comp(void)
+{
+	motor_encoder_comp_set(motor, NULL);
+	encoder_comp_loaded = false;
+
+	int ret = settings_delete("app/knob/encoder_comp");
+	if (ret != 0) {
+		LOG_ERR("Failed deleting encoder compensation: %d", ret);
+	}
+}
+#endif
+
+#ifdef CONFIG_SETTINGS
+#define KNOB_CALIBRATION_VERSION 1
+
+struct knob_calibration {
+	float zero_offset;
+	int32_t direction;
+	uint32_t version;
+	// CRC of the fields above, so that stale or corrupted data is never applied
+	uint32_t fingerprint;
+};
+
+static struct knob_calibration calibration;
+static bool calibration_loaded = false;
+
+static uint32_t knob_app_calibration_fingerprint(const struct knob_calibration *calib)
+{
+	return crc32_ieee((const uint8_t *)calib, offsetof(struct knob_calibration, fingerprint));
+}
+
+static void knob_app_save_calibration(void)
+{
+	enum motor_direction direction;
+
+	motor_calibrate_get(motor, &calibration.zero_offset, &direction);
+	calibration.direction = direction;
+	calibration.version = KNOB_CALIBRATION_VERSION;
+	calibration.fingerprint = knob_app_calibration_fingerprint(&calibration);
+
+	int ret = settings_save_one("app/knob/calibration", &calibration, sizeof(calibration));
+	if (ret != 0) {
+		LOG_ERR("Failed saving calibration: %d", ret);
+	} else {
+		LOG_DBG("Saved calibration");
+	}
+}
+
+static bool knob_app_restore_calibration(void)
+{
+	if (!calibration_loaded) {
+		return false;
+	}
+
+	motor_calibrate_set(motor, calibration.zero_offset, calibration.direction);
+
+	int ret = motor_calibrate_verify(motor);
+	if (ret != 0) {
+		LOG_WRN("Saved calibration does not match the motor: %d", ret);
+		motor_calibrate_set(motor, 0.0f, UNKNOWN);
+#ifdef CONFIG_KNOB_MOTOR_ENCODER_COMP
+		// A stale table skews the zero offset too, capture both again
+		knob_app_clear_encoder_comp();
+#endif
+		return false;
+	}
+
+	LOG_INF("Restored calibration");
+	return true;
+}
+#endif
+
 static void knob_app_calibrate(struct k_work *work)
 {
 	ZMK_EVENT_RAISE(new_app_knob_state_changed((struct app_knob_state_changed){
@@ -93,8 +186,26 @@ static void knob_app_calibrate(struct k_work *work)
 		.calibration = KNOB_CALIBRATING,
 	}));
 
-	int ret = motor_calibrate_auto(motor);
+	int ret;
+
+#ifdef CONFIG_SETTINGS
+	if (knob_app_restore_calibration()) {
+		ret = 0;
+	} else {
+		ret = motor_calibrate_auto(motor);
+		if (ret == 0) {
+			knob_app_save_calibration();
+		}
+	}
+#else
+	ret = motor_calibrate_auto(motor);
+#endif
+
 	if (ret == 0) {
+#if defined(CONFIG_SETTINGS) && defined(CONFIG_KNOB_MOTOR_ENCODER_COMP)
+		knob_app_save_encoder_comp();
+#endif
+
 		knob_app_apply_pref(zmk_keymap_highest_layer_active());
 
 		ZMK_EVENT_RAISE(new_app_knob_state_changed((struct app_knob_state_changed){
@@ -115,6 +226,96 @@ static void knob_app_calibrate(struct k_work *work)
 
 K_WORK_DEFINE(calibrate_work, knob_app_calibrate);
 
+#ifdef CONFIG_KNOB_MOTOR_ANTICOGGING
+static int16_t anticogging[MOTOR_ANTICOGGING_SIZE];
+static enum knob_app_anticogging anticogging_state = KNOB_ANTICOGGING_NONE;
+
+static void knob_app_calibrate_anticogging_work(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	knob_app_disable_report();
+
+	int ret = motor_calibrate_anticogging(motor);
+	if (ret == 0) {
+#ifdef CONFIG_SETTINGS
+		motor_anticogging_get(motor, anticogging);
+		ret = settings_save_one("app/knob/anticogging", anticogging, sizeof(anticogging));
+		if (ret != 0) {
+			LOG_ERR("Failed saving anti-cogging table: %d", ret);
+		} else {
+			LOG_DBG("Saved anti-cogging table");
+		}
+#endif
+		anticogging_state = KNOB_ANTICOGGING_READY;
+	} else {
+		LOG_ERR("Anti-cogging calibration failed: %d", ret);
+		anticogging_state = KNOB_ANTICOGGING_FAILED;
+	}
+
+	// The rotor went a revolution forth and back, let the profile start over from here, and
+	// catch up with the layer and activity changes held off meanwhile
+	knob_set_mode(knob, knob_get_mode(knob));
+	if (!motor_demo) {
+		knob_app_apply_pref(zmk_keymap_highest_layer_active());
+		knob_set_enable(knob, zmk_activity_get_state() == ZMK_ACTIVITY_ACTIVE);
+	}
+}
+
+K_WORK_DEFINE(anticogging_work, knob_app_calibrate_anticogging_work);
+
+enum knob_app_anticogging knob_app_get_anticogging(void)
+{
+	return anticogging_state;
+}
+
+static inline bool knob_app_anticogging_running(void)
+{
+	return anticogging_state == KNOB_ANTICOGGING_RUNNING;
+}
+
+int knob_app_calibrate_anticogging(void)
+{
+	if (!knob || !motor) {
+		return -ENODEV;
+	}
+
+	if (!motor_is_calibrated(motor)) {
+		return -EINVAL;
+	}
+
+	if (anticogging_state == KNOB_ANTICOGGING_RUNNING) {
+		return -EBUSY;
+	}
+
+	anticogging_state = KNOB_ANTICOGGING_RUNNING;
+	k_work_submit_to_queue(&knob_work_q, &anticogging_work);
+
+	return 0;
+}
+
+int knob_app_clear_anticogging(void)
+{
+	if (anticogging_state == KNOB_ANTICOGGING_RUNNING) {
+		return -EBUSY;
+	}
+
+	motor_anticogging_set(motor, NULL);
+	anticogging_state = KNOB_ANTICOGGING_NONE;
+
+#ifdef CONFIG_SETTINGS
+	return settings_delete("app/knob/anticogging");
+#else
+	return 0;
+#endif
+}
+#else
+static inline bool knob_app_anticogging_running(void)
+{
+	return false;
+}
+#endif
+
 bool knob_app_get_demo(void)
 {
 	return motor_demo;
@@ -126,7 +327,7 @@ void knob_app_set_demo(bool demo)
 		return;
 	}
 
-	if (!motor_is_calibrated(motor)) {
+	if (!motor_is_calibrated(motor) || knob_app_anticogging_running()) {
 		return;
 	}
 
@@ -192,6 +393,72 @@ static int knob_app_settings_load_cb(const char *name, size_t len, settings_read
 		return ret;
 	}
 
+	if (settings_name_steq(name, "calibration", &next) && !next) {
+		if (len != sizeof(calibration)) {
+			LOG_ERR("Invalid calibration size: %d", len);
+			return -EINVAL;
+		}
+
+		ret = read_cb(cb_arg, &calibration, sizeof(calibration));
+		if (ret < 0) {
+			LOG_ERR("Failed to read calibration: %d", ret);
+			return 0;
+		}
+
+		calibration_loaded =
+			calibration.version == KNOB_CALIBRATION_VERSION &&
+			calibration.fingerprint == knob_app_calibration_fingerprint(&calibration) &&
+			(calibration.direction == CW || calibration.direction == CCW);
+
+		LOG_DBG("Loaded calibration, valid: %d", calibration_loaded);
+
+		return 0;
+	}
+
+#ifdef CONFIG_KNOB_MOTOR_ENCODER_COMP
+	if (settings_name_steq(name, "encoder_comp", &next) && !next) {
+		if (len != sizeof(encoder_comp)) {
+			LOG_ERR("Invalid encoder compensation size: %d", len);
+			return -EINVAL;
+		}
+
+		ret = read_cb(cb_arg, encoder_comp, sizeof(encoder_comp));
+		if (ret < 0) {
+			LOG_ERR("Failed to read encoder compensation: %d", ret);
+			return 0;
+		}
+
+		motor_encoder_comp_set(motor, encoder_comp);
+		encoder_comp_loaded = true;
+
+		LOG_DBG("Loaded encoder compensation");
+
+		return 0;
+	}
+#endif
+
+#ifdef CONFIG_KNOB_MOTOR_ANTICOGGING
+	if (settings_name_steq(name, "anticogging", &next) && !next) {
+		if (len != sizeof(anticogging)) {
+			LOG_ERR("Invalid anti-cogging table size: %d", len);
+			return -EINVAL;
+		}
+
+		ret = read_cb(cb_arg, anticogging, sizeof(anticogging));
+		if (ret < 0) {
+			LOG_ERR("Failed to read anti-cogging table: %d", ret);
+			return 0;
+		}
+
+		motor_anticogging_set(motor, anticogging);
+		anticogging_state = KNOB_ANTICOGGING_READY;
+
+		LOG_DBG("Loaded anti-cogging table");
+
+		return 0;
+	}
+#endif
+
 	return -ENOENT;
 }
 
@@ -238,6 +505,11 @@ const struct knob_pref *knob_app_get_pref(uint8_t layer_id)
 
 static void knob_app_apply_pref(uint8_t layer_id)
 {
+	// Applied once the calibration is done
+	if (knob_app_anticogging_running()) {
+		return;
+	}
+
 	knob_app_disable_report();
 
 	struct knob_pref *pref = &knob_prefs[layer_id];
@@ -286,7 +558,7 @@ static int knob_app_event_listener(const zmk_event_t *eh)
 		return -ENODEV;
 	}
 
-	if (!motor_is_calibrated(motor) || motor_demo) {
+	if (!motor_is_calibrated(motor) || motor_demo || knob_app_anticogging_running()) {
 		return 0;
 	}
 
@@ -24,3 +24,14 @@ int knob_app_get_prefs(const struct knob_pref **prefs, const char ***names);
 const struct knob_pref *knob_app_get_pref(uint8_t layer_id);
 void knob_app_set_pref(uint8_t layer_id, struct knob_pref *pref);
 void knob_app_reset_pref(uint8_t layer_id);
+
+enum knob_app_anticogging {
+	KNOB_ANTICOGGING_NONE,
+	KNOB_ANTICOGGING_RUNNING,
+	KNOB_ANTICOGGING_READY,
+	KNOB_ANTICOGGING_FAILED,
+};
+
+enum knob_app_anticogging knob_app_get_anticogging(void);
+int knob_app_calibrate_anticogging(void);
+int knob_app_clear_anticogging(void);
@@ -11,8 +11,10 @@
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(uart_comm, CONFIG_HW75_UART_COMM_LOG_LEVEL);
 
+#include <pb_encode.h>
 #include <pb_decode.h>
 
+#include "uart_comm.h"
 #include "handler/handler.h"
 
 #define SLIP_NODE DT_ALIAS(uart_comm)
@@ -24,11 +26,114 @@ struct k_thread thread;
 
 static const struct device *slip = DEVICE_DT_GET(SLIP_NODE);
 
-static struct {
-	uart_comm_Action action;
-	uart_comm_handler_t handler;
-} handlers[] = {
-	{ uart_comm_Action_FN_STATE_CHANGED, handle_fn_state },
+struct uart_comm_inflight {
+	uint32_t id;
+	uart_comm_MessageK2D *response;
+	struct k_sem done;
+};
+
+// Requests waiting for the response from keyboard, free while `id` is 0
+static struct uart_comm_inflight inflight[CONFIG_HW75_UART_COMM_MAX_INFLIGHT];
+static uint32_t next_id = 1;
+
+static K_MUTEX_DEFINE(inflight_lock);
+
+static struct uart_comm_inflight *uart_comm_inflight_alloc(uart_comm_MessageK2D *response)
+{
+	struct uart_comm_inflight *req = NULL;
+
+	k_mutex_lock(&inflight_lock, K_FOREVER);
+	for (int i = 0; i < ARRAY_SIZE(inflight); i++) {
+		if (inflight[i].id == 0) {
+			req = &inflight[i];
+			break;
+		}
+	}
+	if (req != NULL) {
+		req->id = next_id++;
+		if (next_id == 0) {
+			next_id = 1;
+		}
+		req->response = response;
+		k_sem_reset(&req->done);
+	}
+	k_mutex_unlock(&inflight_lock);
+
+	return req;
+}
+
+static void uart_comm_inflight_free(struct uart_comm_inflight *req)
+{
+	k_mutex_lock(&inflight_lock, K_FOREVER);
+	req->id = 0;
+	req->response = NULL;
+	k_mutex_unlock(&inflight_lock);
+}
+
+static bool uart_comm_inflight_complete(const uart_comm_MessageK2D *k2d)
+{
+	bool found = false;
+
+	// Free slots have `id` 0, never match them
+	if (k2d->reply_to == 0) {
+		return false;
+	}
+
+	k_mutex_lock(&inflight_lock, K_FOREVER);
+	for (int i = 0; i < ARRAY_SIZE(inflight); i++) {
+		if (inflight[i].id == k2d->reply_to) {
+			*inflight[i].response = *k2d;
+			k_sem_give(&inflight[i].done);
+			found = true;
+			break;
+		}
+	}
+	k_mutex_unlock(&inflight_lock);
+
+	return found;
+}
+
+int uart_comm_request(uart_comm_MessageD2K *d2k, uart_comm_MessageK2D *k2d, k_timeout_t timeout)
+{
+	uint8_t uart_tx_buf[CONFIG_HW75_UART_COMM_MAX_TX_MESSAGE_SIZE];
+	int ret;
+
+	struct uart_comm_inflight *req = uart_comm_inflight_alloc(k2d);
+	if (req == NULL) {
+		return -EBUSY;
+	}
+
+	d2k->has_id = true;
+	d2k->id = req->id;
+
+	LOG_DBG("req action: %d, id: %d", d2k->action, d2k->id);
+
+	pb_ostream_t d2k_stream = pb_ostream_from_buffer(uart_tx_buf, sizeof(uart_tx_buf));
+	if (!pb_encode_delimited(&d2k_stream, uart_comm_MessageD2K_fields, d2k)) {
+		LOG_ERR("Failed encoding d2k message: %s", d2k_stream.errmsg);
+		uart_comm_inflight_free(req);
+		return -EINVAL;
+	}
+
+	ret = uart_slip_send(slip, uart_tx_buf, d2k_stream.bytes_written);
+	if (ret == 0) {
+		ret = k_sem_take(&req->done, timeout) == 0 ? 0 : -ETIMEDOUT;
+	}
+
+	uart_comm_inflight_free(req);
+
+	if (ret == 0 && k2d->has_status && k2d->status != uart_comm_Status_OK) {
+		LOG_WRN("Request %d of action %d failed on keyboard: %d", d2k->id, d2k->action,
+			k2d->status);
+		ret = k2d->status == uart_comm_Status_UNSUPPORTED ? -ENOTSUP : -EIO;
+	}
+
+	return ret;
+}
+
+// Indexed by action, duplicated entries fail the build with -Werror=override-init
+static const uart_comm_handler_t handlers[_uart_comm_Action_ARRAYSIZE] = {
+	[uart_comm_Action_FN_STATE_CHANGED] = handle_fn_state,
 };
 
 static void uart_comm_handle(uint32_t len)
@@ -43,13 +148,17 @@ static void uart_comm_handle(uint32_t len)
 		return;
 	}
 
+	if (k2d.has_reply_to) {
+		if (!uart_comm_inflight_complete(&k2d)) {
+			LOG_WRN("No request waiting for response %d", k2d.reply_to);
+		}
+		return;
+	}
+
 	LOG_DBG("report action: %d", k2d.action);
 
-	for (size_t i = 0; i < ARRAY_SIZE(handlers); i++) {
-		if (handlers[i].action == k2d.action) {
-			handlers[i].handler(&k2d);
-			break;
-		}
+	if ((uint32_t)k2d.action < ARRAY_SIZE(handlers) && handlers[k2d.action] != NULL) {
+		handlers[k2d.action](&k2d);
 	}
 }
 
@@ -62,8 +171,9 @@ static void uart_comm_thread(void *p1, void *p2, void *p3)
 	uint32_t len;
 
 	while (1) {
-		uart_slip_receive(slip, uart_rx_buf, sizeof(uart_rx_buf), &len);
-		uart_comm_handle(len);
+		if (uart_slip_receive(slip, uart_rx_buf, sizeof(uart_rx_buf), &len) == 0) {
+			uart_comm_handle(len);
+		}
 	}
 }
 
@@ -71,6 +181,10 @@ static int uart_comm_init(const struct device *dev)
 {
 	ARG_UNUSED(dev);
 
+	for (int i = 0; i < ARRAY_SIZE(inflight); i++) {
+		k_sem_init(&inflight[i].done, 0, 1);
+	}
+
 	k_thread_create(&thread, thread_stack, CONFIG_HW75_UART_COMM_THREAD_STACK_SIZE,
 			(k_thread_entry_t)uart_comm_thread, NULL, NULL, NULL,
 			K_PRIO_COOP(CONFIG_HW75_UART_COMM_THREAD_PRIORITY), 0, K_NO_WAIT);
@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <zephyr/kernel.h>
+
+#include "uart_comm.pb.h"
+
+/**
+ * @brief Send a request to keyboard and wait for its response
+ *
+ * @param[in] d2k      Request, its `id` is assigned here
+ * @param[out] k2d     Response
+ * @param[in] timeout  Max time to wait for the response
+ *
+ * @return 0 on success, -EBUSY if too many requests are in flight, -ETIMEDOUT if no response
+ *         arrives in time, -ENOTSUP or -EIO if the keyboard has no handler for the action or
+ *         it failed, or other negative error
+ */
+int uart_comm_request(uart_comm_MessageD2K *d2k, uart_comm_MessageK2D *k2d, k_timeout_t timeout);
@@ -0,0 +1,13 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "uart_comm.pb.h"
+
+typedef bool (*uart_comm_handler_t)(const uart_comm_MessageD2K *d2k, uart_comm_MessageK2D *k2d);
+
+bool handle_ping(const uart_comm_MessageD2K *d2k, uart_comm_MessageK2D *k2d);
+bool handle_kscan_get_stats(const uart_comm_MessageD2K *d2k, uart_comm_MessageK2D *k2d);
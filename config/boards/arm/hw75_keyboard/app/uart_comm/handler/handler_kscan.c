@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "handler.h"
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/kscan/kscan_74hc165.h>
+
+#define KSCAN_NODE DT_CHOSEN(zmk_kscan)
+
+static const struct device *kscan = DEVICE_DT_GET(KSCAN_NODE);
+
+bool handle_kscan_get_stats(const uart_comm_MessageD2K *d2k, uart_comm_MessageK2D *k2d)
+{
+	uart_comm_KscanStats *res = &k2d->payload.kscan_stats;
+	struct kscan_74hc165_stats stats;
+
+	kscan_74hc165_get_stats(kscan, &stats);
+
+	res->scans = stats.scans;
+	res->idle_scans = stats.idle_scans;
+	res->scans_per_second = stats.scans_per_second;
+	res->period_ms = stats.period_ms;
+
+	return true;
+}
@@ -0,0 +1,11 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "handler.h"
+
+bool handle_ping(const uart_comm_MessageD2K *d2k, uart_comm_MessageK2D *k2d)
+{
+	return true;
+}
@@ -12,25 +12,122 @@
 LOG_MODULE_REGISTER(uart_comm, CONFIG_HW75_UART_COMM_LOG_LEVEL);
 
 #include <pb_encode.h>
+#include <pb_decode.h>
 
 #include "report/report.h"
+#include "handler/handler.h"
 
 #define SLIP_NODE DT_ALIAS(uart_comm)
 
-static uint8_t uart_tx_buf[CONFIG_HW75_UART_COMM_MAX_TX_MESSAGE_SIZE];
+static uint8_t uart_rx_buf[CONFIG_HW75_UART_COMM_MAX_RX_MESSAGE_SIZE];
+
+K_THREAD_STACK_MEMBER(thread_stack, CONFIG_HW75_UART_COMM_THREAD_STACK_SIZE);
+struct k_thread thread;
 
 static const struct device *slip = DEVICE_DT_GET(SLIP_NODE);
 
-bool uart_comm_report(uart_comm_MessageK2D *k2d)
-{
-	LOG_DBG("report action: %d", k2d->action);
+// Indexed by action, duplicated entries fail the build with -Werror=override-init
+static const struct {
+	uart_comm_handler_t handler;
+	pb_size_t response_payload;
+} handlers[_uart_comm_Action_ARRAYSIZE] = {
+	[uart_comm_Action_PING] = { handle_ping, uart_comm_MessageK2D_nop_tag },
+	[uart_comm_Action_KSCAN_GET_STATS] = { handle_kscan_get_stats,
+					       uart_comm_MessageK2D_kscan_stats_tag },
+};
 
+static int uart_comm_send(uart_comm_MessageK2D *k2d, bool wait)
+{
+	uint8_t uart_tx_buf[CONFIG_HW75_UART_COMM_MAX_TX_MESSAGE_SIZE];
 	pb_ostream_t k2d_stream = pb_ostream_from_buffer(uart_tx_buf, sizeof(uart_tx_buf));
 
 	if (!pb_encode_delimited(&k2d_stream, uart_comm_MessageK2D_fields, k2d)) {
 		LOG_ERR("Failed encoding k2d message: %s", k2d_stream.errmsg);
+		return -EINVAL;
+	}
+
+	if (wait) {
+		return uart_slip_send(slip, uart_tx_buf, k2d_stream.bytes_written);
+	} else {
+		return uart_slip_send_nowait(slip, uart_tx_buf, k2d_stream.bytes_written);
+	}
+}
+
+bool uart_comm_report(uart_comm_MessageK2D *k2d)
+{
+	LOG_DBG("report action: %d", k2d->action);
+
+	// Reports are sent from the ZMK event path, never hold it waiting for the UART
+	int ret = uart_comm_send(k2d, false);
+	if (ret < 0) {
+		LOG_WRN("Dropped report action %d: %d", k2d->action, ret);
 		return false;
 	}
 
-	return uart_slip_send(slip, uart_tx_buf, k2d_stream.bytes_written) == 0;
+	return true;
 }
+
+static void uart_comm_handle(uint32_t len)
+{
+	LOG_HEXDUMP_DBG(uart_rx_buf, len, "RX");
+
+	pb_istream_t d2k_stream = pb_istream_from_buffer(uart_rx_buf, len);
+
+	uart_comm_MessageD2K d2k = uart_comm_MessageD2K_init_zero;
+	if (!pb_decode_delimited(&d2k_stream, uart_comm_MessageD2K_fields, &d2k)) {
+		LOG_ERR("Failed decoding d2k message: %s", d2k_stream.errmsg);
+		return;
+	}
+
+	LOG_DBG("req action: %d, id: %d", d2k.action, d2k.id);
+
+	if (!d2k.has_id || d2k.id == 0) {
+		return;
+	}
+
+	uart_comm_MessageK2D k2d = uart_comm_MessageK2D_init_zero;
+	k2d.action = d2k.action;
+	k2d.which_payload = uart_comm_MessageK2D_nop_tag;
+	k2d.has_reply_to = true;
+	k2d.reply_to = d2k.id;
+	k2d.has_status = true;
+
+	if ((uint32_t)d2k.action >= ARRAY_SIZE(handlers) || handlers[d2k.action].handler == NULL) {
+		k2d.status = uart_comm_Status_UNSUPPORTED;
+	} else if (handlers[d2k.action].handler(&d2k, &k2d)) {
+		k2d.which_payload = handlers[d2k.action].response_payload;
+		k2d.status = uart_comm_Status_OK;
+	} else {
+		k2d.status = uart_comm_Status_FAILED;
+	}
+
+	uart_comm_send(&k2d, true);
+}
+
+static void uart_comm_thread(void *p1, void *p2, void *p3)
+{
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	uint32_t len;
+
+	while (1) {
+		if (uart_slip_receive(slip, uart_rx_buf, sizeof(uart_rx_buf), &len) == 0) {
+			uart_comm_handle(len);
+		}
+	}
+}
+
+static int uart_comm_init(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	k_thread_create(&thread, thread_stack, CONFIG_HW75_UART_COMM_THREAD_STACK_SIZE,
+			(k_thread_entry_t)uart_comm_thread, NULL, NULL, NULL,
+			K_PRIO_COOP(CONFIG_HW75_UART_COMM_THREAD_PRIORITY), 0, K_NO_WAIT);
+
+	return 0;
+}
+
+SYS_INIT(uart_comm_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
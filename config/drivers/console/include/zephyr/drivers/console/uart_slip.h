@@ -17,7 +17,10 @@ extern "C" {
 #include <stdint.h>
 
 /**
- * @brief Encode and send data over UART
+ * @brief Encode and queue data to send over UART
+ *
+ * The frame is sent in background by the UART TX interrupt. The calling thread only waits if
+ * the TX buffer has no room for the whole frame.
  *
  * @param[in] dev   Device instance
  * @param[in] buf   Pointer to data to send
@@ -28,7 +31,21 @@ extern "C" {
 int uart_slip_send(const struct device *dev, const uint8_t *buf, uint32_t len);
 
 /**
- * @brief Receive and decode data from UART
+ * @brief Encode and queue data to send over UART without waiting
+ *
+ * @param[in] dev   Device instance
+ * @param[in] buf   Pointer to data to send
+ * @param[in] len   Number of bytes to send
+ *
+ * @return 0 on success, -EAGAIN if the TX buffer has no room for the frame now, -EMSGSIZE if
+ *         the frame never fits, or other negative error
+ */
+int uart_slip_send_nowait(const struct device *dev, const uint8_t *buf, uint32_t len);
+
+/**
+ * @brief Receive a frame decoded from UART
+ *
+ * Frames are decoded by the UART RX interrupt. The calling thread sleeps until one is complete.
  *
  * @param[in] dev   Device instance
  * @param[in] buf   Pointer to data buffer to write to
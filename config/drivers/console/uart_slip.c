@@ -8,6 +8,8 @@
 #include <zephyr/device.h>
 #include <zephyr/kernel.h>
 
+#include <string.h>
+
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(uart_slip, CONFIG_UART_SLIP_LOG_LEVEL);
 
@@ -27,132 +29,224 @@ enum uart_slip_state {
 	STATE_ESC,
 };
 
+struct uart_slip_frame {
+	uint32_t len;
+	uint8_t buf[CONFIG_UART_SLIP_RX_FRAME_SIZE];
+};
+
 struct uart_slip_data {
-	uint8_t rx_buf[CONFIG_UART_SLIP_RX_RING_BUFFER_SIZE];
-	struct ring_buf rx_rb;
+	// Decoded by the RX interrupt, and queued once complete
+	struct uart_slip_frame rx_frame;
+	char __aligned(4) rx_msgq_buf[CONFIG_UART_SLIP_RX_FRAME_QUEUE_SIZE *
+				      sizeof(struct uart_slip_frame)];
+	struct k_msgq rx_msgq;
 
 	enum uart_slip_state state;
+
+	uint8_t tx_buf[CONFIG_UART_SLIP_TX_RING_BUFFER_SIZE];
+	struct ring_buf tx_rb;
+	struct k_spinlock tx_lock;
+	struct k_sem tx_sem;
 };
 
 struct uart_slip_config {
 	const struct device *uart;
 };
 
-int uart_slip_send(const struct device *dev, const uint8_t *buf, uint32_t len)
+static uint32_t uart_slip_encoded_len(const uint8_t *buf, uint32_t len)
 {
-	const struct uart_slip_config *config = dev->config;
+	uint32_t encoded = len + 2;
+	for (uint32_t i = 0; i < len; i++) {
+		if (buf[i] == SLIP_END || buf[i] == SLIP_ESC) {
+			encoded++;
+		}
+	}
+	return encoded;
+}
 
-	uint8_t b;
+static void uart_slip_encode(struct ring_buf *rb, const uint8_t *buf, uint32_t len)
+{
+	static const uint8_t end = SLIP_END;
+	static const uint8_t esc_end[] = {SLIP_ESC, SLIP_ESC_END};
+	static const uint8_t esc_esc[] = {SLIP_ESC, SLIP_ESC_ESC};
 
-	LOG_HEXDUMP_DBG(buf, len, "TX");
+	uint32_t run = 0;
 
-	uart_poll_out(config->uart, SLIP_END);
-	while (len--) {
-		b = *buf++;
-		switch (b) {
-		case SLIP_END:
-			uart_poll_out(config->uart, SLIP_ESC);
-			uart_poll_out(config->uart, SLIP_ESC_END);
-			break;
-		case SLIP_ESC:
-			uart_poll_out(config->uart, SLIP_ESC);
-			uart_poll_out(config->uart, SLIP_ESC_ESC);
-			break;
-		default:
-			uart_poll_out(config->uart, b);
-			break;
+	ring_buf_put(rb, &end, 1);
+	for (uint32_t i = 0; i < len; i++) {
+		if (buf[i] != SLIP_END && buf[i] != SLIP_ESC) {
+			continue;
+		}
+
+		// Copy the bytes that need no escaping in one go
+		ring_buf_put(rb, buf + run, i - run);
+		run = i + 1;
+
+		if (buf[i] == SLIP_END) {
+			ring_buf_put(rb, esc_end, sizeof(esc_end));
+		} else {
+			ring_buf_put(rb, esc_esc, sizeof(esc_esc));
 		}
 	}
-	uart_poll_out(config->uart, SLIP_END);
+	ring_buf_put(rb, buf + run, len - run);
+	ring_buf_put(rb, &end, 1);
+}
+
+int uart_slip_send_nowait(const struct device *dev, const uint8_t *buf, uint32_t len)
+{
+	struct uart_slip_data *data = dev->data;
+	const struct uart_slip_config *config = dev->config;
+
+	uint32_t encoded_len = uart_slip_encoded_len(buf, len);
+	if (encoded_len > ring_buf_capacity_get(&data->tx_rb)) {
+		return -EMSGSIZE;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&data->tx_lock);
+
+	if (ring_buf_space_get(&data->tx_rb) < encoded_len) {
+		k_spin_unlock(&data->tx_lock, key);
+		return -EAGAIN;
+	}
+
+	LOG_HEXDUMP_DBG(buf, len, "TX");
+
+	// The whole frame is queued at once, so frames of different senders never interleave
+	uart_slip_encode(&data->tx_rb, buf, len);
+	uart_irq_tx_enable(config->uart);
+
+	k_spin_unlock(&data->tx_lock, key);
 
 	return 0;
 }
 
-int uart_slip_receive(const struct device *dev, uint8_t *buf, uint32_t limit, uint32_t *len)
+int uart_slip_send(const struct device *dev, const uint8_t *buf, uint32_t len)
 {
 	struct uart_slip_data *data = dev->data;
+	int ret;
+
+	while ((ret = uart_slip_send_nowait(dev, buf, len)) == -EAGAIN) {
+		k_sem_take(&data->tx_sem, K_FOREVER);
+	}
+
+	return ret;
+}
 
-	uint8_t b;
+int uart_slip_receive(const struct device *dev, uint8_t *buf, uint32_t limit, uint32_t *len)
+{
+	struct uart_slip_data *data = dev->data;
+	struct uart_slip_frame frame;
 
 	*len = 0;
-	while (*len <= limit) {
-		if (!ring_buf_get(&data->rx_rb, &b, 1)) {
-			k_usleep(10);
-			continue;
-		}
+	k_msgq_get(&data->rx_msgq, &frame, K_FOREVER);
 
-		switch (data->state) {
-		case STATE_SKIP: {
-			if (b == SLIP_END) {
-				data->state = STATE_BYTE;
-			}
-		} break;
-		case STATE_BYTE: {
-			if (b == SLIP_ESC) {
-				data->state = STATE_ESC;
-			} else if (b == SLIP_END) {
-				if (*len > 0) {
-					LOG_HEXDUMP_DBG(buf, *len, "RX");
-					return 0;
-				}
-			} else {
-				*(buf + *len) = b;
-				*len += 1;
-			}
-		} break;
-		case STATE_ESC: {
-			if (b == SLIP_ESC_END) {
-				*(buf + *len) = SLIP_END;
-				*len += 1;
-				data->state = STATE_BYTE;
-			} else if (b == SLIP_ESC_ESC) {
-				*(buf + *len) = SLIP_ESC;
-				*len += 1;
-				data->state = STATE_BYTE;
-			} else {
-				// this state is unnormal
-				// skip all following bytes until next SLIP_END
-				data->state = STATE_SKIP;
+	if (frame.len > limit) {
+		return -ENOMEM;
+	}
+
+	memcpy(buf, frame.buf, frame.len);
+	*len = frame.len;
+	LOG_HEXDUMP_DBG(buf, *len, "RX");
+
+	return 0;
+}
+
+static void uart_slip_decode(struct uart_slip_data *data, uint8_t b)
+{
+	struct uart_slip_frame *frame = &data->rx_frame;
+
+	switch (data->state) {
+	case STATE_SKIP: {
+		if (b == SLIP_END) {
+			frame->len = 0;
+			data->state = STATE_BYTE;
+		}
+		return;
+	}
+	case STATE_BYTE: {
+		if (b == SLIP_ESC) {
+			data->state = STATE_ESC;
+			return;
+		} else if (b == SLIP_END) {
+			if (frame->len > 0 && k_msgq_put(&data->rx_msgq, frame, K_NO_WAIT) != 0) {
+				LOG_ERR("Frame queue full, dropping frame");
 			}
-		} break;
+			frame->len = 0;
+			return;
+		}
+	} break;
+	case STATE_ESC: {
+		if (b == SLIP_ESC_END) {
+			b = SLIP_END;
+		} else if (b == SLIP_ESC_ESC) {
+			b = SLIP_ESC;
+		} else {
+			// this state is unnormal
+			// skip all following bytes until next SLIP_END
+			data->state = STATE_SKIP;
+			return;
 		}
+		data->state = STATE_BYTE;
+	} break;
+	}
 
-		k_yield();
+	if (frame->len >= sizeof(frame->buf)) {
+		LOG_ERR("Frame exceeds %d bytes, dropping frame", sizeof(frame->buf));
+		data->state = STATE_SKIP;
+		return;
 	}
 
-	return -ENOMEM;
+	frame->buf[frame->len++] = b;
 }
 
-static void uart_slip_isr(const struct device *uart, void *user_data)
+static void uart_slip_isr_tx(const struct device *uart, struct uart_slip_data *data)
 {
-	const struct device *dev = (const struct device *)user_data;
-	struct uart_slip_data *data = dev->data;
+	uint8_t *buf;
+	uint32_t len;
+	int ret;
+
+	k_spinlock_key_t key = k_spin_lock(&data->tx_lock);
 
+	len = ring_buf_get_claim(&data->tx_rb, &buf, UINT32_MAX);
+	if (!len) {
+		uart_irq_tx_disable(uart);
+		k_spin_unlock(&data->tx_lock, key);
+		return;
+	}
+
+	ret = uart_fifo_fill(uart, buf, len);
+	ring_buf_get_finish(&data->tx_rb, MAX(ret, 0));
+
+	k_spin_unlock(&data->tx_lock, key);
+
+	if (ret > 0) {
+		k_sem_give(&data->tx_sem);
+	}
+}
+
+static void uart_slip_isr_rx(const struct device *uart, struct uart_slip_data *data)
+{
+	uint8_t buf[16];
 	int ret;
-	uint8_t *buf;
-	uint32_t bytes_allocated = 0;
-	uint32_t bytes_read = 0;
 
 	while (uart_irq_update(uart) && uart_irq_rx_ready(uart)) {
-		if (!bytes_allocated) {
-			bytes_allocated = ring_buf_put_claim(&data->rx_rb, &buf, UINT32_MAX);
-		}
-		if (!bytes_allocated) {
-			LOG_ERR("Ring buffer full");
-			break;
+		ret = uart_fifo_read(uart, buf, sizeof(buf));
+		for (int i = 0; i < ret; i++) {
+			uart_slip_decode(data, buf[i]);
 		}
+	}
+}
 
-		ret = uart_fifo_read(uart, buf, bytes_allocated);
-		if (ret <= 0) {
-			continue;
-		}
+static void uart_slip_isr(const struct device *uart, void *user_data)
+{
+	const struct device *dev = (const struct device *)user_data;
+	struct uart_slip_data *data = dev->data;
 
-		buf += ret;
-		bytes_read += ret;
-		bytes_allocated -= ret;
-	}
+	uart_slip_isr_rx(uart, data);
 
-	ring_buf_put_finish(&data->rx_rb, bytes_read);
+	if (uart_irq_update(uart) && uart_irq_tx_ready(uart)) {
+		uart_slip_isr_tx(uart, data);
+	}
 }
 
 int uart_slip_init(const struct device *dev)
@@ -165,7 +259,10 @@ int uart_slip_init(const struct device *dev)
 		return -ENODEV;
 	}
 
-	ring_buf_init(&data->rx_rb, sizeof(data->rx_buf), data->rx_buf);
+	k_msgq_init(&data->rx_msgq, data->rx_msgq_buf, sizeof(struct uart_slip_frame),
+		    CONFIG_UART_SLIP_RX_FRAME_QUEUE_SIZE);
+	ring_buf_init(&data->tx_rb, sizeof(data->tx_buf), data->tx_buf);
+	k_sem_init(&data->tx_sem, 0, 1);
 
 	uart_irq_rx_disable(config->uart);
 	uart_irq_tx_disable(config->uart);
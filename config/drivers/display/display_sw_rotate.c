@@ -25,6 +25,7 @@ struct sw_rotate_config {
 	uint16_t dst_height;
 	uint16_t src_width;
 	uint16_t src_height;
+	uint16_t buffer_items;
 };
 
 static int sw_rotate_blanking_on(const struct device *dev)
@@ -47,36 +48,56 @@ static int sw_rotate_write(const struct device *dev, const uint16_t x, const uin
 	struct sw_rotate_data *data = dev->data;
 	const struct sw_rotate_config *config = dev->config;
 
-	if (desc->pitch != desc->width) {
+	if (desc->pitch < desc->width) {
 		LOG_ERR("Unsupported mode");
 		return -1;
 	}
 
-	const struct display_buffer_descriptor desc_rot = {
-		.buf_size = desc->buf_size,
-		.width = desc->height,
-		.height = desc->width,
-		.pitch = desc->height,
-	};
+	if (x % BITS_PER_ITEM != 0 || desc->width % BITS_PER_ITEM != 0 ||
+	    desc->pitch % BITS_PER_ITEM != 0) {
+		LOG_ERR("Unaligned region: x %d, width %d, pitch %d", x, desc->width, desc->pitch);
+		return -EINVAL;
+	}
 
 	const uint8_t *s = (const uint8_t *)buf;
+	const uint16_t sp = desc->pitch / BITS_PER_ITEM;
 	const uint16_t sw = desc->width / BITS_PER_ITEM;
 	const uint16_t sh = desc->height;
 
+	const uint16_t dst_x = config->dst_width - y - desc->height;
+
 	uint8_t *d = data->buffer;
 	uint16_t dx, dy;
+	int ret;
+
+	// Each source column of bytes becomes a row of bytes at the destination, so the frame is
+	// rotated and written in chunks of buffer_items columns.
+	for (uint16_t sx0 = 0; sx0 < sw; sx0 += config->buffer_items) {
+		const uint16_t n = MIN(config->buffer_items, sw - sx0);
+
+		const struct display_buffer_descriptor desc_rot = {
+			.buf_size = sh * n,
+			.width = sh,
+			.height = n * BITS_PER_ITEM,
+			.pitch = sh,
+		};
+
+		for (uint16_t sy = 0; sy < sh; sy++) {
+			for (uint16_t sx = sx0; sx < sx0 + n; sx++) {
+				dx = (desc->height - 1) - sy;
+				dy = sx - sx0;
+				d[dx + sh * dy] = s[sp * sy + sx];
+			}
+		}
 
-	for (uint16_t sy = 0; sy < sh; sy++) {
-		for (uint16_t sx = 0; sx < sw; sx++) {
-			dx = (desc->height - 1) - sy;
-			dy = sx;
-			d[dx + sh * dy] = s[sw * sy + sx];
+		ret = display_write(config->dst, dst_x, x + sx0 * BITS_PER_ITEM, &desc_rot,
+				    data->buffer);
+		if (ret != 0) {
+			return ret;
 		}
 	}
 
-	const uint16_t dst_x = config->dst_width - y - desc->height;
-	const uint16_t dst_y = x;
-	return display_write(config->dst, dst_x, dst_y, &desc_rot, data->buffer);
+	return 0;
 }
 
 static int sw_rotate_read(const struct device *dev, const uint16_t x, const uint16_t y,
@@ -171,10 +192,13 @@ static const struct display_driver_api sw_rotate_api = {
 	.set_orientation = sw_rotate_set_orientation,
 };
 
-#define SW_ROTATE_BUFFER_SIZE(n)                                                                   \
-	(DT_INST_PROP(n, height) * DT_INST_PROP_OR(n, buffer_lines, 32) / BITS_PER_ITEM)
+#define SW_ROTATE_BUFFER_ITEMS(n) (DT_INST_PROP_OR(n, buffer_lines, 32) / BITS_PER_ITEM)
+
+#define SW_ROTATE_BUFFER_SIZE(n) (DT_INST_PROP(n, height) * SW_ROTATE_BUFFER_ITEMS(n))
 
 #define SW_ROTATE_INIT(n)                                                                          \
+	BUILD_ASSERT(SW_ROTATE_BUFFER_ITEMS(n) > 0, "buffer-lines should be at least 8");          \
+                                                                                                   \
 	static uint8_t sw_rotate_buffer_##n[SW_ROTATE_BUFFER_SIZE(n)] = {};                        \
                                                                                                    \
 	static struct sw_rotate_data sw_rotate_data_##n = {                                        \
@@ -187,6 +211,7 @@ static const struct display_driver_api sw_rotate_api = {
 		.dst_height = DT_INST_PROP_BY_PHANDLE(n, display, height),                         \
 		.src_width = DT_INST_PROP(n, width),                                               \
 		.src_height = DT_INST_PROP(n, height),                                             \
+		.buffer_items = SW_ROTATE_BUFFER_ITEMS(n),                                         \
 	};                                                                                         \
                                                                                                    \
 	DEVICE_DT_INST_DEFINE(n, sw_rotate_init, NULL, &sw_rotate_data_##n, &sw_rotate_config_##n, \
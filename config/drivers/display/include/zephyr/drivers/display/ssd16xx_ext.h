@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+/**
+ * @file
+ * @brief Extended public API for ssd16xx
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include <zephyr/device.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Hold back the panel refresh of subsequent writes
+ *
+ * While held, display_write() only loads the controller RAM, so that a frame can be written in
+ * several chunks and refreshed once with ssd16xx_refresh() or display_blanking_off().
+ *
+ * @param[in] dev   Device instance
+ * @param[in] hold  Whether to hold back the refresh
+ *
+ * @return 0 on success or negative error
+ */
+int ssd16xx_hold(const struct device *dev, bool hold);
+
+/**
+ * @brief Refresh the panel with the RAM loaded while held
+ *
+ * @param[in] dev   Device instance
+ *
+ * @return 0 on success, 1 if the same frame must be written again to keep the controller RAM up
+ *         to date after a partial refresh, or negative error
+ */
+int ssd16xx_refresh(const struct device *dev);
+
+/**
+ * @brief Wait for the controller to finish the ongoing refresh
+ *
+ * The calling thread sleeps until the BUSY pin is released, rather than polling it.
+ *
+ * @param[in] dev   Device instance
+ *
+ * @return 0 on success or negative error
+ */
+int ssd16xx_wait(const struct device *dev);
+
+#ifdef __cplusplus
+}
+#endif
@@ -19,6 +19,7 @@ LOG_MODULE_REGISTER(ssd16xx);
 #include <zephyr/sys/byteorder.h>
 
 #include <zephyr/display/ssd16xx.h>
+#include <zephyr/drivers/display/ssd16xx_ext.h>
 #include "ssd16xx_regs.h"
 
 /**
@@ -69,7 +70,11 @@ struct ssd16xx_data {
 	bool read_supported;
 	uint8_t scan_mode;
 	bool blanking_on;
+	bool held;
 	enum ssd16xx_profile_type profile;
+	bool busy_irq;
+	struct k_sem busy_sem;
+	struct gpio_callback busy_cb;
 };
 
 struct ssd16xx_dt_array {
@@ -117,14 +122,32 @@ static int ssd16xx_controller_init(const struct device *dev);
 static int ssd16xx_set_profile(const struct device *dev,
 			       enum ssd16xx_profile_type type);
 
+static void ssd16xx_busy_callback(const struct device *port,
+				  struct gpio_callback *cb, uint32_t pins)
+{
+	struct ssd16xx_data *data =
+		CONTAINER_OF(cb, struct ssd16xx_data, busy_cb);
+
+	k_sem_give(&data->busy_sem);
+}
+
 static inline void ssd16xx_busy_wait(const struct device *dev)
 {
 	const struct ssd16xx_config *config = dev->config;
+	struct ssd16xx_data *data = dev->data;
+	const k_timeout_t timeout = data->busy_irq ?
+				    K_MSEC(SSD16XX_BUSY_TIMEOUT) :
+				    K_MSEC(SSD16XX_BUSY_DELAY);
 	int pin = gpio_pin_get_dt(&config->busy_gpio);
 
 	while (pin > 0) {
 		__ASSERT(pin >= 0, "Failed to get pin level");
-		k_msleep(SSD16XX_BUSY_DELAY);
+		/*
+		 * Sleep until the busy pin is released. A stale give
+		 * only costs another round, and the timeout guards
+		 * against a missed edge.
+		 */
+		k_sem_take(&data->busy_sem, timeout);
 		pin = gpio_pin_get_dt(&config->busy_gpio);
 	}
 }
@@ -500,7 +523,12 @@ static int ssd16xx_write(const struct device *dev, const uint16_t x,
 		return err;
 	}
 
-	if (!data->blanking_on) {
+	/*
+	 * When held, the refresh is left to ssd16xx_refresh(), which
+	 * also tells the caller whether the whole frame has to be
+	 * written once again.
+	 */
+	if (!data->blanking_on && !data->held) {
 		err = ssd16xx_update_display(dev);
 		if (err < 0) {
 			return err;
@@ -521,7 +549,7 @@ static int ssd16xx_write(const struct device *dev, const uint16_t x,
 		if (err < 0) {
 			return err;
 		}
-	} else if (partial_refresh) {
+	} else if (partial_refresh && !data->held) {
 		/*
 		 * We just performed a partial refresh. After the
 		 * refresh, the controller swaps the black/red buffers
@@ -539,6 +567,40 @@ static int ssd16xx_write(const struct device *dev, const uint16_t x,
 	return 0;
 }
 
+int ssd16xx_hold(const struct device *dev, bool hold)
+{
+	struct ssd16xx_data *data = dev->data;
+
+	data->held = hold;
+
+	return 0;
+}
+
+int ssd16xx_wait(const struct device *dev)
+{
+	ssd16xx_busy_wait(dev);
+
+	return 0;
+}
+
+int ssd16xx_refresh(const struct device *dev)
+{
+	struct ssd16xx_data *data = dev->data;
+	int err;
+
+	if (data->blanking_on) {
+		/* The refresh happens when blanking is turned off */
+		return 0;
+	}
+
+	err = ssd16xx_update_display(dev);
+	if (err < 0) {
+		return err;
+	}
+
+	return data->profile == SSD16XX_PROFILE_PARTIAL ? 1 : 0;
+}
+
 int ssd16xx_read_ram(const struct device *dev, enum ssd16xx_ram ram_type,
 		     const uint16_t x, const uint16_t y,
 		     const struct display_buffer_descriptor *desc,
@@ -995,6 +1057,21 @@ static int ssd16xx_init(const struct device *dev)
 		return err;
 	}
 
+	k_sem_init(&data->busy_sem, 0, 1);
+	gpio_init_callback(&data->busy_cb, ssd16xx_busy_callback,
+			   BIT(config->busy_gpio.pin));
+
+	err = gpio_add_callback(config->busy_gpio.port, &data->busy_cb);
+	if (err == 0) {
+		err = gpio_pin_interrupt_configure_dt(&config->busy_gpio,
+						      GPIO_INT_EDGE_TO_INACTIVE);
+	}
+
+	data->busy_irq = err == 0;
+	if (!data->busy_irq) {
+		LOG_WRN("Busy GPIO interrupt not available, polling");
+	}
+
 	if (config->width > config->quirks->max_width ||
 	    config->height > config->quirks->max_height) {
 		LOG_ERR("Display size out of range.");
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <zephyr/sys/util.h>
+
+#include "debounce_bitsliced.h"
+
+void debounce_bitsliced_config_init(struct debounce_bitsliced_config *config, int press_ms,
+                                    int release_ms, int scan_period_ms) {
+    // zmk_debounce_update() flips once the counter, growing by scan_period_ms per scan, is no
+    // longer below the threshold.
+    config->press_ticks = DIV_ROUND_UP(press_ms, scan_period_ms);
+    config->release_ticks = DIV_ROUND_UP(release_ms, scan_period_ms);
+
+    const uint32_t max_ticks = MAX(config->press_ticks, config->release_ticks);
+    config->bits = max_ticks ? 32 - __builtin_clz(max_ticks) : 0;
+}
+
+// Lanes whose counter is greater than or equal to the constant
+static uint32_t counter_ge(const struct debounce_bitsliced_state *state, uint8_t bits,
+                           uint32_t value) {
+    uint32_t gt = 0, eq = ~0U;
+
+    for (int i = bits - 1; i >= 0; i--) {
+        if (value & BIT(i)) {
+            eq &= state->counter[i];
+        } else {
+            gt |= eq & state->counter[i];
+            eq &= ~state->counter[i];
+        }
+    }
+
+    return gt | eq;
+}
+
+static uint32_t counter_nonzero(const struct debounce_bitsliced_state *state, uint8_t bits) {
+    uint32_t nz = 0;
+
+    for (int i = 0; i < bits; i++) {
+        nz |= state->counter[i];
+    }
+
+    return nz;
+}
+
+uint32_t debounce_bitsliced_update(struct debounce_bitsliced_state *state, uint32_t active,
+                                   const struct debounce_bitsliced_config *config) {
+    const uint8_t bits = config->bits;
+
+    const uint32_t disagree = active ^ state->pressed;
+    const uint32_t reached = (~state->pressed & counter_ge(state, bits, config->press_ticks)) |
+                             (state->pressed & counter_ge(state, bits, config->release_ticks));
+
+    const uint32_t flip = disagree & reached;
+    uint32_t carry = disagree & ~reached;
+    uint32_t borrow = ~disagree & counter_nonzero(state, bits);
+
+    for (int i = 0; i < bits; i++) {
+        const uint32_t c = state->counter[i];
+
+        state->counter[i] = (c ^ carry ^ borrow) & ~flip;
+        carry &= c;
+        borrow &= ~c;
+    }
+
+    state->pressed ^= flip;
+
+    return flip;
+}
+
+uint32_t debounce_bitsliced_is_active(const struct debounce_bitsliced_state *state,
+                                      const struct debounce_bitsliced_config *config) {
+    return state->pressed | counter_nonzero(state, config->bits);
+}
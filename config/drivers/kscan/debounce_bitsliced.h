@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Debounces 32 inputs at once with the same integrator as zmk_debounce_update(), keeping the
+ * counters bit-sliced: counter[i] holds bit i of the counter of every input.
+ *
+ * Counters run in scans rather than milliseconds, which matches zmk_debounce_update() when it
+ * is always called with the same elapsed time.
+ */
+
+#define DEBOUNCE_BITSLICED_MAX_BITS 8
+
+/** Largest threshold, in scans, that fits in the counters. */
+#define DEBOUNCE_BITSLICED_MAX_TICKS ((1 << DEBOUNCE_BITSLICED_MAX_BITS) - 1)
+
+struct debounce_bitsliced_config {
+    /** Scans an input must disagree with a released state before it is pressed. */
+    uint8_t press_ticks;
+    /** Scans an input must disagree with a pressed state before it is released. */
+    uint8_t release_ticks;
+    /** Number of counter slices in use, enough to hold the larger threshold. */
+    uint8_t bits;
+};
+
+struct debounce_bitsliced_state {
+    uint32_t pressed;
+    uint32_t counter[DEBOUNCE_BITSLICED_MAX_BITS];
+};
+
+/**
+ * Converts the thresholds in milliseconds to scans of scan_period_ms.
+ */
+void debounce_bitsliced_config_init(struct debounce_bitsliced_config *config, int press_ms,
+                                    int release_ms, int scan_period_ms);
+
+/**
+ * Feeds one scan to 32 debouncers.
+ *
+ * @param active  Raw state of the inputs, set when pressed.
+ * @return Mask of the inputs whose debounced state flipped in this scan.
+ */
+uint32_t debounce_bitsliced_update(struct debounce_bitsliced_state *state, uint32_t active,
+                                   const struct debounce_bitsliced_config *config);
+
+/**
+ * Mask of the inputs that are pressed or still counting.
+ */
+uint32_t debounce_bitsliced_is_active(const struct debounce_bitsliced_state *state,
+                                      const struct debounce_bitsliced_config *config);
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+/**
+ * @file
+ * @brief Extended public API for kscan_gpio_74hc165
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <zephyr/device.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct kscan_74hc165_stats {
+    /** Scans done since boot. */
+    uint32_t scans;
+    /** Scans since boot that found nothing changed and no key being debounced. */
+    uint32_t idle_scans;
+    /** Scans done in the last full second. */
+    uint32_t scans_per_second;
+    /** Period the scan currently runs at. */
+    uint32_t period_ms;
+};
+
+/**
+ * @brief Get the scan statistics
+ *
+ * @param[in] dev    Device instance
+ * @param[out] stats Statistics
+ *
+ * @return 0 on success or negative error
+ */
+int kscan_74hc165_get_stats(const struct device *dev, struct kscan_74hc165_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
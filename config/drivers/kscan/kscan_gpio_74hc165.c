@@ -8,12 +8,21 @@
 #include <zephyr/devicetree.h>
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/drivers/kscan.h>
+#include <zephyr/drivers/kscan/kscan_74hc165.h>
 #include <zephyr/drivers/spi.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
 #include <zephyr/sys/util.h>
 
+#include <zmk/activity.h>
 #include <zmk/debounce.h>
+#include <zmk/event_manager.h>
+#include <zmk/events/activity_state_changed.h>
+
+#ifdef CONFIG_ZMK_KSCAN_74HC165_DEBOUNCE_BITSLICED
+#include "debounce_bitsliced.h"
+#endif
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
@@ -35,15 +44,38 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 #define NGPIOS 8
 
+/** Number of 32-bit words holding one bit per input of the chain. */
+#define KSCAN_74HC165_WORDS(len) DIV_ROUND_UP(len, sizeof(uint32_t))
+
 struct kscan_74hc165_data {
     const struct device *dev;
     kscan_callback_t callback;
-    struct k_work_delayable work;
-    /** Timestamp of the current or scheduled scan. */
-    int64_t scan_time;
+    struct k_thread thread;
+    /** Paces the scans, given by the timer on every period. */
+    struct k_timer timer;
+    struct k_sem tick;
+    /** Period the timer currently runs at. */
+    int32_t period_ms;
+    /** Uptime of the last scan that saw a key change or being debounced. */
+    uint32_t last_activity;
+    /** Start and scan count of the window scans_per_second is measured over. */
+    uint32_t window_start;
+    uint32_t window_scans;
+    struct kscan_74hc165_stats stats;
+#ifdef CONFIG_ZMK_KSCAN_74HC165_DEBOUNCE_BITSLICED
+    /** Debouncers of 32 inputs per word. */
+    struct debounce_bitsliced_state *word_state;
+    struct debounce_bitsliced_config bitsliced_config;
+#else
     /** Current state of the inputs as an array of length config->inputs.len */
     struct zmk_debounce_state *pin_state;
+#endif
+    /** Raw read buffer, padded to a whole number of words. */
     uint8_t *read_buf;
+    /** Raw state of the previous scan, one bit per input, set when released or masked. */
+    uint32_t *snapshot;
+    /** Inputs whose debouncer is pressed or still counting. */
+    uint32_t *active;
 };
 
 struct kscan_74hc165_config {
@@ -54,25 +86,99 @@ struct kscan_74hc165_config {
     const uint8_t *scan_masks;
     int32_t debounce_scan_period_ms;
     int32_t poll_period_ms;
+    int32_t idle_poll_period_ms;
+    int32_t active_hold_ms;
+    k_thread_stack_t *stack;
+    size_t stack_size;
 };
 
-static void kscan_74hc165_read_continue(const struct device *dev) {
-    const struct kscan_74hc165_config *config = dev->config;
+/** Whether ZMK considers the keyboard idle or asleep, shared by all instances. */
+static bool kscan_74hc165_idle = false;
+
+static void kscan_74hc165_set_period(const struct device *dev, int32_t period_ms) {
+    struct kscan_74hc165_data *data = dev->data;
+
+    if (data->period_ms != period_ms) {
+        data->period_ms = period_ms;
+        k_timer_start(&data->timer, K_MSEC(period_ms), K_MSEC(period_ms));
+    }
+}
+
+#ifdef CONFIG_ZMK_KSCAN_74HC165_DEBOUNCE_BITSLICED
+static void kscan_74hc165_update_word(const struct device *dev, uint32_t w, uint32_t raw) {
+    struct kscan_74hc165_data *data = dev->data;
+    struct debounce_bitsliced_state *state = &data->word_state[w];
+
+    uint32_t changed = debounce_bitsliced_update(state, ~raw, &data->bitsliced_config);
+
+    while (changed) {
+        const uint32_t bit = __builtin_ctz(changed);
+        const uint32_t pin = w * 32 + bit;
+        const bool pressed = state->pressed & BIT(bit);
+        changed &= changed - 1;
+
+        const int i = pin / NGPIOS, j = pin % NGPIOS;
+        LOG_DBG("Sending event at %i,%i state %s", i, j, pressed ? "on" : "off");
+        data->callback(dev, i, j, pressed);
+    }
+
+    data->active[w] = debounce_bitsliced_is_active(state, &data->bitsliced_config);
+}
+#else
+static void kscan_74hc165_update_pin(const struct device *dev, uint32_t pin, bool pressed) {
     struct kscan_74hc165_data *data = dev->data;
+    const struct kscan_74hc165_config *config = dev->config;
+    struct zmk_debounce_state *state = &data->pin_state[pin];
 
-    data->scan_time += config->debounce_scan_period_ms;
+    zmk_debounce_update(state, pressed, config->debounce_scan_period_ms,
+                        &config->debounce_config);
 
-    k_work_reschedule(&data->work, K_TIMEOUT_ABS_MS(data->scan_time));
+    if (zmk_debounce_get_changed(state)) {
+        const int i = pin / NGPIOS, j = pin % NGPIOS;
+        LOG_DBG("Sending event at %i,%i state %s", i, j,
+                zmk_debounce_is_pressed(state) ? "on" : "off");
+        data->callback(dev, i, j, zmk_debounce_is_pressed(state));
+    }
+
+    WRITE_BIT(data->active[pin / 32], pin % 32, zmk_debounce_is_active(state));
 }
+#endif
 
-static void kscan_74hc165_read_end(const struct device *dev) {
+// Scans quickly while keys are being debounced and for active-hold-ms after, so that the next
+// key of a burst is picked up as fast as the first one. The period then doubles on every idle
+// scan, up to poll-period-ms, or idle-poll-period-ms while ZMK is idle.
+static void kscan_74hc165_govern(const struct device *dev, bool changed, bool active) {
     struct kscan_74hc165_data *data = dev->data;
     const struct kscan_74hc165_config *config = dev->config;
+    const uint32_t now = k_uptime_get_32();
 
-    data->scan_time += config->poll_period_ms;
+    data->stats.scans++;
+    data->window_scans++;
 
-    // Return to polling slowly.
-    k_work_reschedule(&data->work, K_TIMEOUT_ABS_MS(data->scan_time));
+    if (!changed && !active) {
+        data->stats.idle_scans++;
+    }
+
+    if (now - data->window_start >= MSEC_PER_SEC) {
+        data->stats.scans_per_second =
+            data->window_scans * MSEC_PER_SEC / (now - data->window_start);
+        data->window_start = now;
+        data->window_scans = 0;
+    }
+
+    if (changed || active) {
+        data->last_activity = now;
+    }
+
+    if (active || (int32_t)(now - data->last_activity) < config->active_hold_ms) {
+        kscan_74hc165_set_period(dev, config->debounce_scan_period_ms);
+        return;
+    }
+
+    const int32_t ceiling =
+        kscan_74hc165_idle ? config->idle_poll_period_ms : config->poll_period_ms;
+
+    kscan_74hc165_set_period(dev, MIN(data->period_ms * 2, ceiling));
 }
 
 static int kscan_74hc165_read(const struct device *dev) {
@@ -90,50 +196,64 @@ static int kscan_74hc165_read(const struct device *dev) {
 
     gpio_pin_set_dt(&config->load_gpio, true);
     gpio_pin_set_dt(&config->load_gpio, false);
-    spi_read_dt(&config->bus, &rx_bufs);
 
-    uint8_t bits;
+    int err = spi_read_dt(&config->bus, &rx_bufs);
+    if (err) {
+        LOG_ERR("Failed to read shift registers: %d", err);
+        return err;
+    }
+
     for (int i = 0; i < config->chain_length; i++) {
-        bits = data->read_buf[i] | ~config->scan_masks[i];
-        for (int j = 0; j < NGPIOS; j++) {
-            zmk_debounce_update(&data->pin_state[i * NGPIOS + j], (bits & BIT(j)) == 0,
-                                config->debounce_scan_period_ms, &config->debounce_config);
-        }
+        data->read_buf[i] |= ~config->scan_masks[i];
     }
 
-    // Process the new state.
+    // Only inputs that changed since the previous scan, or whose debouncer has not settled
+    // back to released, need to go through the debouncer.
     bool continue_scan = false;
+    bool changed = false;
 
-    for (int i = 0; i < config->chain_length; i++) {
-        for (int j = 0; j < NGPIOS; j++) {
-            struct zmk_debounce_state *state = &data->pin_state[i * NGPIOS + j];
+    for (int w = 0; w < KSCAN_74HC165_WORDS(config->chain_length); w++) {
+        const uint32_t raw = sys_get_le32(&data->read_buf[w * sizeof(uint32_t)]);
+        uint32_t pending = (raw ^ data->snapshot[w]) | data->active[w];
+
+        changed = changed || raw != data->snapshot[w];
 
-            if (zmk_debounce_get_changed(state)) {
-                const bool pressed = zmk_debounce_is_pressed(state);
-                LOG_DBG("Sending event at %i,%i state %s", i, j, pressed ? "on" : "off");
-                data->callback(dev, i, j, pressed);
-            }
+        data->snapshot[w] = raw;
 
-            continue_scan = continue_scan || zmk_debounce_is_active(state);
+#ifdef CONFIG_ZMK_KSCAN_74HC165_DEBOUNCE_BITSLICED
+        if (pending) {
+            kscan_74hc165_update_word(dev, w, raw);
         }
-    }
+#else
+        while (pending) {
+            const uint32_t bit = __builtin_ctz(pending);
+            pending &= pending - 1;
+
+            kscan_74hc165_update_pin(dev, w * 32 + bit, (raw & BIT(bit)) == 0);
+        }
+#endif
 
-    if (continue_scan) {
-        // At least one key is pressed or the debouncer has not yet decided if
-        // it is pressed. Poll quickly until everything is released.
-        kscan_74hc165_read_continue(dev);
-    } else {
-        // All keys are released. Return to normal.
-        kscan_74hc165_read_end(dev);
+        continue_scan = continue_scan || data->active[w];
     }
 
+    kscan_74hc165_govern(dev, changed, continue_scan);
+
     return 0;
 }
 
-static void kscan_74hc165_work_handler(struct k_work *work) {
-    struct k_work_delayable *dwork = CONTAINER_OF(work, struct k_work_delayable, work);
-    struct kscan_74hc165_data *data = CONTAINER_OF(dwork, struct kscan_74hc165_data, work);
-    kscan_74hc165_read(data->dev);
+static void kscan_74hc165_timer_handler(struct k_timer *timer) {
+    struct kscan_74hc165_data *data = CONTAINER_OF(timer, struct kscan_74hc165_data, timer);
+    k_sem_give(&data->tick);
+}
+
+static void kscan_74hc165_thread(void *p1, void *p2, void *p3) {
+    const struct device *dev = p1;
+    struct kscan_74hc165_data *data = dev->data;
+
+    while (true) {
+        k_sem_take(&data->tick, K_FOREVER);
+        kscan_74hc165_read(dev);
+    }
 }
 
 static int kscan_74hc165_configure(const struct device *dev, kscan_callback_t callback) {
@@ -149,13 +269,20 @@ static int kscan_74hc165_configure(const struct device *dev, kscan_callback_t ca
 
 static int kscan_74hc165_enable(const struct device *dev) {
     struct kscan_74hc165_data *data = dev->data;
-    data->scan_time = k_uptime_get();
-    return kscan_74hc165_read(dev);
+    const struct kscan_74hc165_config *config = dev->config;
+
+    // Scan right away, then keep the timer running at a steady period.
+    data->period_ms = config->poll_period_ms;
+    data->window_start = k_uptime_get_32();
+    data->window_scans = 0;
+    k_timer_start(&data->timer, K_NO_WAIT, K_MSEC(data->period_ms));
+    return 0;
 }
 
 static int kscan_74hc165_disable(const struct device *dev) {
     struct kscan_74hc165_data *data = dev->data;
-    k_work_cancel_delayable(&data->work);
+    k_timer_stop(&data->timer);
+    k_sem_reset(&data->tick);
     return 0;
 }
 
@@ -181,30 +308,98 @@ static int kscan_74hc165_init(const struct device *dev) {
         return err;
     }
 
-    k_work_init_delayable(&data->work, kscan_74hc165_work_handler);
+    const size_t words = KSCAN_74HC165_WORDS(config->chain_length);
+
+    // Padding bytes past the chain read as released and are never scanned.
+    memset(data->read_buf, 0xFF, words * sizeof(uint32_t));
+    memset(data->snapshot, 0xFF, words * sizeof(uint32_t));
+    memset(data->active, 0, words * sizeof(uint32_t));
+
+#ifdef CONFIG_ZMK_KSCAN_74HC165_DEBOUNCE_BITSLICED
+    memset(data->word_state, 0, words * sizeof(struct debounce_bitsliced_state));
+    debounce_bitsliced_config_init(&data->bitsliced_config,
+                                   config->debounce_config.debounce_press_ms,
+                                   config->debounce_config.debounce_release_ms,
+                                   config->debounce_scan_period_ms);
+#endif
+
+    k_sem_init(&data->tick, 0, 1);
+    k_timer_init(&data->timer, kscan_74hc165_timer_handler, NULL);
+
+    k_thread_create(&data->thread, config->stack, config->stack_size, kscan_74hc165_thread,
+                    (void *)dev, NULL, NULL,
+                    K_PRIO_PREEMPT(CONFIG_ZMK_KSCAN_74HC165_THREAD_PRIORITY), 0, K_NO_WAIT);
+    k_thread_name_set(&data->thread, dev->name);
+
+    return 0;
+}
+
+int kscan_74hc165_get_stats(const struct device *dev, struct kscan_74hc165_stats *stats) {
+    struct kscan_74hc165_data *data = dev->data;
+
+    *stats = data->stats;
+    stats->period_ms = data->period_ms;
+
+    return 0;
+}
+
+static int kscan_74hc165_activity_listener(const zmk_event_t *eh) {
+    if (as_zmk_activity_state_changed(eh)) {
+        // Takes effect from the next scan of each instance.
+        kscan_74hc165_idle = zmk_activity_get_state() != ZMK_ACTIVITY_ACTIVE;
+    }
 
     return 0;
 }
 
+ZMK_LISTENER(kscan_74hc165, kscan_74hc165_activity_listener);
+ZMK_SUBSCRIPTION(kscan_74hc165, zmk_activity_state_changed);
+
 static const struct kscan_driver_api kscan_74hc165_api = {
     .config = kscan_74hc165_configure,
     .enable_callback = kscan_74hc165_enable,
     .disable_callback = kscan_74hc165_disable,
 };
 
+#ifdef CONFIG_ZMK_KSCAN_74HC165_DEBOUNCE_BITSLICED
+#define KSCAN_74HC165_DEBOUNCE_STATE(n)                                                            \
+    BUILD_ASSERT(DIV_ROUND_UP(INST_DEBOUNCE_PRESS_MS(n),                                           \
+                              DT_INST_PROP(n, debounce_scan_period_ms)) <=                         \
+                     DEBOUNCE_BITSLICED_MAX_TICKS,                                                 \
+                 "debounce-press-ms is too large for the bit-sliced debouncer");                   \
+    BUILD_ASSERT(DIV_ROUND_UP(INST_DEBOUNCE_RELEASE_MS(n),                                         \
+                              DT_INST_PROP(n, debounce_scan_period_ms)) <=                         \
+                     DEBOUNCE_BITSLICED_MAX_TICKS,                                                 \
+                 "debounce-release-ms is too large for the bit-sliced debouncer");                 \
+    static struct debounce_bitsliced_state                                                         \
+        kscan_74hc165_state_##n[KSCAN_74HC165_WORDS(DT_INST_PROP(n, chain_length))];
+#define KSCAN_74HC165_DEBOUNCE_STATE_ASSIGN(n) .word_state = kscan_74hc165_state_##n,
+#else
+#define KSCAN_74HC165_DEBOUNCE_STATE(n)                                                            \
+    static struct zmk_debounce_state kscan_74hc165_state_##n[DT_INST_PROP(n, chain_length) * 8];
+#define KSCAN_74HC165_DEBOUNCE_STATE_ASSIGN(n) .pin_state = kscan_74hc165_state_##n,
+#endif
+
 #define KSCAN_74HC165_INIT(n)                                                                      \
     BUILD_ASSERT(INST_DEBOUNCE_PRESS_MS(n) <= DEBOUNCE_COUNTER_MAX,                                \
                  "ZMK_KSCAN_DEBOUNCE_PRESS_MS or debounce-press-ms is too large");                 \
     BUILD_ASSERT(INST_DEBOUNCE_RELEASE_MS(n) <= DEBOUNCE_COUNTER_MAX,                              \
                  "ZMK_KSCAN_DEBOUNCE_RELEASE_MS or debounce-release-ms is too large");             \
                                                                                                    \
-    static struct zmk_debounce_state kscan_74hc165_state_##n[DT_INST_PROP(n, chain_length) * 8];   \
+    KSCAN_74HC165_DEBOUNCE_STATE(n)                                                                \
+                                                                                                   \
+    static uint32_t kscan_74hc165_read_buf_##n[KSCAN_74HC165_WORDS(DT_INST_PROP(n, chain_length))];\
+    static uint32_t kscan_74hc165_snapshot_##n[KSCAN_74HC165_WORDS(DT_INST_PROP(n, chain_length))];\
+    static uint32_t kscan_74hc165_active_##n[KSCAN_74HC165_WORDS(DT_INST_PROP(n, chain_length))];  \
                                                                                                    \
-    static uint8_t kscan_74hc165_read_buf_##n[DT_INST_PROP(n, chain_length)];                      \
+    static K_THREAD_STACK_DEFINE(kscan_74hc165_stack_##n,                                          \
+                                 CONFIG_ZMK_KSCAN_74HC165_THREAD_STACK_SIZE);                      \
                                                                                                    \
     static struct kscan_74hc165_data kscan_74hc165_data_##n = {                                    \
-        .pin_state = kscan_74hc165_state_##n,                                                      \
-        .read_buf = kscan_74hc165_read_buf_##n,                                                    \
+        KSCAN_74HC165_DEBOUNCE_STATE_ASSIGN(n)                                                     \
+        .read_buf = (uint8_t *)kscan_74hc165_read_buf_##n,                                         \
+        .snapshot = kscan_74hc165_snapshot_##n,                                                    \
+        .active = kscan_74hc165_active_##n,                                                        \
     };                                                                                             \
                                                                                                    \
     static uint8_t kscan_74hc165_scan_masks_##n[DT_INST_PROP(n, chain_length)] =                   \
@@ -223,6 +418,10 @@ static const struct kscan_driver_api kscan_74hc165_api = {
         .scan_masks = kscan_74hc165_scan_masks_##n,                                                \
         .debounce_scan_period_ms = DT_INST_PROP(n, debounce_scan_period_ms),                       \
         .poll_period_ms = DT_INST_PROP(n, poll_period_ms),                                         \
+        .idle_poll_period_ms = DT_INST_PROP(n, idle_poll_period_ms),                               \
+        .active_hold_ms = DT_INST_PROP(n, active_hold_ms),                                         \
+        .stack = kscan_74hc165_stack_##n,                                                          \
+        .stack_size = K_THREAD_STACK_SIZEOF(kscan_74hc165_stack_##n),                              \
     };                                                                                             \
                                                                                                    \
     DEVICE_DT_INST_DEFINE(n, &kscan_74hc165_init, NULL, &kscan_74hc165_data_##n,                   \
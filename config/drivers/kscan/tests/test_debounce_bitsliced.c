@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+// The bit-sliced debouncer must flip and settle on exactly the same scans as the per-pin
+// zmk_debounce_update() it replaces, for any raw input.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <zephyr/sys/util.h>
+
+#include "debounce_bitsliced.h"
+
+// Copy of app/src/debounce.c in ZMK
+
+#define DEBOUNCE_COUNTER_BITS 14
+#define DEBOUNCE_COUNTER_MAX BIT_MASK(DEBOUNCE_COUNTER_BITS)
+
+struct zmk_debounce_state {
+    bool pressed : 1;
+    bool changed : 1;
+    uint16_t counter : DEBOUNCE_COUNTER_BITS;
+};
+
+struct zmk_debounce_config {
+    uint32_t debounce_press_ms;
+    uint32_t debounce_release_ms;
+};
+
+static uint32_t get_threshold(const struct zmk_debounce_state *state,
+                              const struct zmk_debounce_config *config) {
+    return state->pressed ? config->debounce_release_ms : config->debounce_press_ms;
+}
+
+static void increment_counter(struct zmk_debounce_state *state, const int elapsed_ms) {
+    if (state->counter + elapsed_ms > DEBOUNCE_COUNTER_MAX) {
+        state->counter = DEBOUNCE_COUNTER_MAX;
+    } else {
+        state->counter += elapsed_ms;
+    }
+}
+
+static void decrement_counter(struct zmk_debounce_state *state, const int elapsed_ms) {
+    if (state->counter < elapsed_ms) {
+        state->counter = 0;
+    } else {
+        state->counter -= elapsed_ms;
+    }
+}
+
+static void zmk_debounce_update(struct zmk_debounce_state *state, const bool active,
+                                const int elapsed_ms, const struct zmk_debounce_config *config) {
+    state->changed = false;
+
+    if (active == state->pressed) {
+        decrement_counter(state, elapsed_ms);
+        return;
+    }
+
+    const uint32_t flip_threshold = get_threshold(state, config);
+
+    if (state->counter < flip_threshold) {
+        increment_counter(state, elapsed_ms);
+        return;
+    }
+
+    state->pressed = !state->pressed;
+    state->counter = 0;
+    state->changed = true;
+}
+
+static bool zmk_debounce_is_active(const struct zmk_debounce_state *state) {
+    return state->pressed || state->counter > 0;
+}
+
+// End of copy
+
+#define WORDS 4
+#define SCANS 20000
+#define BENCH_SCANS 200000
+
+static int failures;
+
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// Mask with each bit set with a probability of about 1 / 2^shift
+static uint32_t rng_sparse(int shift) {
+    uint32_t mask = ~0U;
+    for (int i = 0; i < shift; i++) {
+        mask &= rng();
+    }
+    return mask;
+}
+
+// Keys held for a while, and reading the wrong level now and then around it
+static void next_raw(uint32_t *held, uint32_t *raw, int scan) {
+    for (int w = 0; w < WORDS; w++) {
+        held[w] ^= rng_sparse(6);
+        raw[w] = held[w] ^ rng_sparse(scan % 3 + 1);
+    }
+}
+
+static void check(int press_ms, int release_ms, int period_ms) {
+    struct zmk_debounce_config ref_config = {
+        .debounce_press_ms = press_ms,
+        .debounce_release_ms = release_ms,
+    };
+    static struct zmk_debounce_state ref[WORDS * 32];
+    struct debounce_bitsliced_config config;
+    struct debounce_bitsliced_state state[WORDS] = {0};
+    uint32_t held[WORDS] = {0}, raw[WORDS];
+    long flips = 0;
+
+    memset(ref, 0, sizeof(ref));
+    debounce_bitsliced_config_init(&config, press_ms, release_ms, period_ms);
+
+    for (int scan = 0; scan < SCANS; scan++) {
+        next_raw(held, raw, scan);
+
+        for (int w = 0; w < WORDS; w++) {
+            uint32_t flip = debounce_bitsliced_update(&state[w], raw[w], &config);
+            uint32_t active = debounce_bitsliced_is_active(&state[w], &config);
+            uint32_t ref_flip = 0, ref_active = 0;
+
+            for (int i = 0; i < 32; i++) {
+                struct zmk_debounce_state *pin = &ref[w * 32 + i];
+                zmk_debounce_update(pin, raw[w] & BIT(i), period_ms, &ref_config);
+                ref_flip |= pin->changed ? BIT(i) : 0;
+                ref_active |= zmk_debounce_is_active(pin) ? BIT(i) : 0;
+            }
+
+            if (flip != ref_flip || active != ref_active) {
+                printf("press %d ms, release %d ms, period %d ms: scan %d word %d: flip %08x "
+                       "expected %08x, active %08x expected %08x\n",
+                       press_ms, release_ms, period_ms, scan, w, flip, ref_flip, active,
+                       ref_active);
+                failures++;
+                return;
+            }
+
+            flips += __builtin_popcount(flip);
+        }
+    }
+
+    // Make sure the stream actually exercised the thresholds
+    if (flips == 0) {
+        printf("press %d ms, release %d ms, period %d ms: nothing flipped\n", press_ms, release_ms,
+               period_ms);
+        failures++;
+    }
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench(void) {
+    struct zmk_debounce_config ref_config = {.debounce_press_ms = 5, .debounce_release_ms = 5};
+    static struct zmk_debounce_state ref[WORDS * 32];
+    static uint32_t raws[256][WORDS];
+    struct debounce_bitsliced_config config;
+    struct debounce_bitsliced_state state[WORDS] = {0};
+    uint32_t held[WORDS] = {0};
+    volatile uint32_t sink = 0;
+
+    debounce_bitsliced_config_init(&config, 5, 5, 1);
+    for (int i = 0; i < ARRAY_SIZE(raws); i++) {
+        next_raw(held, raws[i], i);
+    }
+
+    double start = now_ns();
+    for (int scan = 0; scan < BENCH_SCANS; scan++) {
+        const uint32_t *raw = raws[scan % ARRAY_SIZE(raws)];
+        for (int w = 0; w < WORDS; w++) {
+            for (int i = 0; i < 32; i++) {
+                zmk_debounce_update(&ref[w * 32 + i], raw[w] & BIT(i), 1, &ref_config);
+                sink += ref[w * 32 + i].changed;
+            }
+        }
+    }
+    double per_pin = (now_ns() - start) / BENCH_SCANS;
+
+    start = now_ns();
+    for (int scan = 0; scan < BENCH_SCANS; scan++) {
+        const uint32_t *raw = raws[scan % ARRAY_SIZE(raws)];
+        for (int w = 0; w < WORDS; w++) {
+            sink += debounce_bitsliced_update(&state[w], raw[w], &config);
+        }
+    }
+    double bitsliced = (now_ns() - start) / BENCH_SCANS;
+
+    printf("%d inputs per scan: per-pin %.1f ns, bit-sliced %.1f ns (%.1fx)\n", WORDS * 32,
+           per_pin, bitsliced, per_pin / bitsliced);
+}
+
+int main(void) {
+    static const int thresholds[][3] = {
+        // press ms, release ms, scan period ms
+        {0, 0, 1},
+        {0, 5, 1},
+        {5, 0, 1},
+        {1, 1, 1},
+        {5, 5, 1},
+        {5, 10, 1},
+        {12, 3, 1},
+        {5, 5, 2},
+        {7, 3, 2},
+        {10, 25, 3},
+        {DEBOUNCE_BITSLICED_MAX_TICKS, 1, 1},
+        {1, DEBOUNCE_BITSLICED_MAX_TICKS, 1},
+        {DEBOUNCE_BITSLICED_MAX_TICKS, DEBOUNCE_BITSLICED_MAX_TICKS, 1},
+        {DEBOUNCE_BITSLICED_MAX_TICKS * 2, 0, 2},
+    };
+
+    for (int i = 0; i < ARRAY_SIZE(thresholds); i++) {
+        check(thresholds[i][0], thresholds[i][1], thresholds[i][2]);
+    }
+
+    bench();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
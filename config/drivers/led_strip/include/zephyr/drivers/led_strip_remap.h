@@ -20,6 +20,36 @@ int led_strip_remap_set(const struct device *dev, const char *label, struct led_
 
 int led_strip_remap_clear(const struct device *dev, const char *label);
 
+/**
+ * @brief Look up an indicator by label once, for the *_by_id() variants
+ *
+ * @return Indicator ID or -ENOENT
+ */
+int led_strip_remap_find(const struct device *dev, const char *label);
+
+int led_strip_remap_set_by_id(const struct device *dev, int id, struct led_rgb *pixel);
+
+int led_strip_remap_clear_by_id(const struct device *dev, int id);
+
+/**
+ * @brief Show `pixels` instead of what is written through the LED strip API
+ *
+ * Pixels are in the same order as led_strip_update_rgb(). Updates written meanwhile, e.g. by
+ * the underglow effect, are kept and shown again by led_strip_remap_release(). Indicators are
+ * still drawn on top.
+ *
+ * @return 0 on success or negative error
+ */
+int led_strip_remap_override(const struct device *dev, const struct led_rgb *pixels,
+			     size_t num_pixels);
+
+/**
+ * @brief Stop overriding, and show the pixels written through the LED strip API again
+ *
+ * @return 0 on success or negative error
+ */
+int led_strip_remap_release(const struct device *dev);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,10 +26,19 @@ struct led_strip_remap_indicator_state {
 };
 
 struct led_strip_remap_data {
+	const struct device *dev;
 	struct led_rgb *pixels;
+	/** Shown instead of `pixels` while overridden, see led_strip_remap_override() */
+	struct led_rgb *override;
+	bool overridden;
 	struct led_rgb *output;
 	struct led_strip_remap_indicator_state *indicators;
 	struct k_mutex lock;
+	/** Composes and pushes the dirty layers at most once per frame */
+	struct k_work_delayable flush_work;
+	int64_t last_flush;
+	bool pixels_dirty;
+	uint32_t indicators_dirty;
 };
 
 struct led_strip_remap_config {
@@ -42,20 +51,33 @@ struct led_strip_remap_config {
 	uint32_t indicator_cnt;
 };
 
-static int led_strip_remap_apply(const struct device *dev)
+// Must be called with the lock held
+static void led_strip_remap_compose(const struct device *dev)
 {
 	struct led_strip_remap_data *data = dev->data;
 	const struct led_strip_remap_config *config = dev->config;
-	int ret;
 
-	k_mutex_lock(&data->lock, K_FOREVER);
+	const struct led_strip_remap_indicator *indicator;
+	struct led_strip_remap_indicator_state *indicator_state;
+	const struct led_rgb *pixels = data->overridden ? data->override : data->pixels;
+
+	if (data->pixels_dirty) {
+		memcpy(data->output, pixels, config->map_len * sizeof(struct led_rgb));
+	} else {
+		// Only indicators changed, uncover the LEDs of those from the pixels underneath
+		for (uint32_t i = 0; i < config->indicator_cnt; i++) {
+			if (!(data->indicators_dirty & BIT(i))) {
+				continue;
+			}
 
-	for (uint32_t i = 0; i < config->map_len; i++) {
-		memcpy(&data->output[i], &data->pixels[i], sizeof(struct led_rgb));
+			indicator = &config->indicators[i];
+			for (uint32_t j = 0; j < indicator->led_cnt; j++) {
+				data->output[indicator->led_indexes[j]] =
+					pixels[indicator->led_indexes[j]];
+			}
+		}
 	}
 
-	const struct led_strip_remap_indicator *indicator;
-	struct led_strip_remap_indicator_state *indicator_state;
 	for (uint32_t i = 0; i < config->indicator_cnt; i++) {
 		indicator = &config->indicators[i];
 		indicator_state = &data->indicators[i];
@@ -65,16 +87,45 @@ static int led_strip_remap_apply(const struct device *dev)
 		}
 
 		for (uint32_t j = 0; j < indicator->led_cnt; j++) {
-			memcpy(&data->output[indicator->led_indexes[j]], &indicator_state->color,
-			       sizeof(struct led_rgb));
+			data->output[indicator->led_indexes[j]] = indicator_state->color;
 		}
 	}
 
-	ret = led_strip_update_rgb(config->led_strip, data->output, config->map_len);
+	data->pixels_dirty = false;
+	data->indicators_dirty = 0;
+}
 
+static void led_strip_remap_flush(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct led_strip_remap_data *data =
+		CONTAINER_OF(dwork, struct led_strip_remap_data, flush_work);
+	const struct device *dev = data->dev;
+	const struct led_strip_remap_config *config = dev->config;
+	int ret;
+
+	k_mutex_lock(&data->lock, K_FOREVER);
+	led_strip_remap_compose(dev);
 	k_mutex_unlock(&data->lock);
 
-	return ret;
+	// The output is only written by this work item, so the strip is pushed without the lock
+	data->last_flush = k_uptime_get();
+
+	ret = led_strip_update_rgb(config->led_strip, data->output, config->map_len);
+	if (ret < 0) {
+		LOG_ERR("Failed updating LED strip: %d", ret);
+	}
+}
+
+// Must be called with the lock held
+static void led_strip_remap_schedule(const struct device *dev)
+{
+	struct led_strip_remap_data *data = dev->data;
+	const int64_t next = data->last_flush + CONFIG_LED_STRIP_REMAP_FRAME_PERIOD_MS;
+	const int64_t delay = next - k_uptime_get();
+
+	// No-op if a flush is already scheduled, which then picks up this change as well
+	k_work_schedule(&data->flush_work, delay > 0 ? K_MSEC(delay) : K_NO_WAIT);
 }
 
 static int led_strip_remap_update_rgb(const struct device *dev, struct led_rgb *pixels,
@@ -90,12 +141,18 @@ static int led_strip_remap_update_rgb(const struct device *dev, struct led_rgb *
 	k_mutex_lock(&data->lock, K_FOREVER);
 
 	for (uint32_t i = 0; i < num_pixels; i++) {
-		memcpy(&data->pixels[config->map[i]], &pixels[i], sizeof(struct led_rgb));
+		data->pixels[config->map[i]] = pixels[i];
+	}
+
+	// Kept underneath the override, and shown again once it is released
+	if (!data->overridden) {
+		data->pixels_dirty = true;
+		led_strip_remap_schedule(dev);
 	}
 
 	k_mutex_unlock(&data->lock);
 
-	return led_strip_remap_apply(dev);
+	return 0;
 }
 
 static int led_strip_remap_update_channels(const struct device *dev, uint8_t *channels,
@@ -105,55 +162,112 @@ static int led_strip_remap_update_channels(const struct device *dev, uint8_t *ch
 	return -ENOTSUP;
 }
 
-int led_strip_remap_set(const struct device *dev, const char *label, struct led_rgb *pixel)
+int led_strip_remap_find(const struct device *dev, const char *label)
+{
+	const struct led_strip_remap_config *config = dev->config;
+
+	for (uint32_t i = 0; i < config->indicator_cnt; i++) {
+		if (strcmp(config->indicators[i].label, label) == 0) {
+			return i;
+		}
+	}
+
+	return -ENOENT;
+}
+
+int led_strip_remap_set_by_id(const struct device *dev, int id, struct led_rgb *pixel)
 {
 	struct led_strip_remap_data *data = dev->data;
 	const struct led_strip_remap_config *config = dev->config;
 
+	if (id < 0 || (uint32_t)id >= config->indicator_cnt) {
+		return -EINVAL;
+	}
+
 	k_mutex_lock(&data->lock, K_FOREVER);
 
-	const struct led_strip_remap_indicator *indicator;
-	struct led_strip_remap_indicator_state *indicator_state;
-	for (uint32_t i = 0; i < config->indicator_cnt; i++) {
-		indicator = &config->indicators[i];
-		indicator_state = &data->indicators[i];
+	data->indicators[id].color = *pixel;
+	data->indicators[id].active = true;
+	data->indicators_dirty |= BIT(id);
+	led_strip_remap_schedule(dev);
 
-		if (strcmp(indicator->label, label) != 0) {
-			continue;
-		}
+	k_mutex_unlock(&data->lock);
+
+	return 0;
+}
+
+int led_strip_remap_clear_by_id(const struct device *dev, int id)
+{
+	struct led_strip_remap_data *data = dev->data;
+	const struct led_strip_remap_config *config = dev->config;
+
+	if (id < 0 || (uint32_t)id >= config->indicator_cnt) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&data->lock, K_FOREVER);
 
-		memcpy(&indicator_state->color, pixel, sizeof(struct led_rgb));
-		indicator_state->active = true;
+	if (data->indicators[id].active) {
+		data->indicators[id].active = false;
+		data->indicators_dirty |= BIT(id);
+		led_strip_remap_schedule(dev);
 	}
 
 	k_mutex_unlock(&data->lock);
 
-	return led_strip_remap_apply(dev);
+	return 0;
 }
 
-int led_strip_remap_clear(const struct device *dev, const char *label)
+int led_strip_remap_override(const struct device *dev, const struct led_rgb *pixels,
+			     size_t num_pixels)
 {
 	struct led_strip_remap_data *data = dev->data;
 	const struct led_strip_remap_config *config = dev->config;
 
+	if (num_pixels > config->map_len) {
+		num_pixels = config->map_len;
+	}
+
 	k_mutex_lock(&data->lock, K_FOREVER);
 
-	const struct led_strip_remap_indicator *indicator;
-	struct led_strip_remap_indicator_state *indicator_state;
-	for (uint32_t i = 0; i < config->indicator_cnt; i++) {
-		indicator = &config->indicators[i];
-		indicator_state = &data->indicators[i];
+	for (uint32_t i = 0; i < num_pixels; i++) {
+		data->override[config->map[i]] = pixels[i];
+	}
 
-		if (strcmp(indicator->label, label) != 0) {
-			continue;
-		}
+	data->overridden = true;
+	data->pixels_dirty = true;
+	led_strip_remap_schedule(dev);
+
+	k_mutex_unlock(&data->lock);
+
+	return 0;
+}
+
+int led_strip_remap_release(const struct device *dev)
+{
+	struct led_strip_remap_data *data = dev->data;
 
-		indicator_state->active = false;
+	k_mutex_lock(&data->lock, K_FOREVER);
+
+	if (data->overridden) {
+		data->overridden = false;
+		data->pixels_dirty = true;
+		led_strip_remap_schedule(dev);
 	}
 
 	k_mutex_unlock(&data->lock);
 
-	return led_strip_remap_apply(dev);
+	return 0;
+}
+
+int led_strip_remap_set(const struct device *dev, const char *label, struct led_rgb *pixel)
+{
+	return led_strip_remap_set_by_id(dev, led_strip_remap_find(dev, label), pixel);
+}
+
+int led_strip_remap_clear(const struct device *dev, const char *label)
+{
+	return led_strip_remap_clear_by_id(dev, led_strip_remap_find(dev, label));
 }
 
 static int led_strip_remap_init(const struct device *dev)
@@ -161,7 +275,9 @@ static int led_strip_remap_init(const struct device *dev)
 	struct led_strip_remap_data *data = dev->data;
 	const struct led_strip_remap_config *config = dev->config;
 
+	data->dev = dev;
 	k_mutex_init(&data->lock);
+	k_work_init_delayable(&data->flush_work, led_strip_remap_flush);
 
 	if (config->chain_length != config->led_strip_len) {
 		LOG_ERR("%s: chain-length (%d) should be the same with led-strip device %s (%d)",
@@ -223,6 +339,7 @@ static const struct led_strip_driver_api led_strip_remap_api = {
 
 #define LED_STRIP_REMAP_INIT(n)                                                                    \
 	static struct led_rgb led_strip_remap_pixels_##n[DT_INST_PROP_LEN(n, map)] = { 0 };        \
+	static struct led_rgb led_strip_remap_override_##n[DT_INST_PROP_LEN(n, map)] = { 0 };      \
 	static struct led_rgb led_strip_remap_output_##n[DT_INST_PROP_LEN(n, map)] = { 0 };        \
                                                                                                    \
 	static struct led_strip_remap_indicator_state led_strip_remap_indicator_states_##n[] = {   \
@@ -231,6 +348,7 @@ static const struct led_strip_driver_api led_strip_remap_api = {
                                                                                                    \
 	static struct led_strip_remap_data led_strip_remap_data_##n = {                            \
 		.pixels = led_strip_remap_pixels_##n,                                              \
+		.override = led_strip_remap_override_##n,                                          \
 		.output = led_strip_remap_output_##n,                                              \
 		.indicators = led_strip_remap_indicator_states_##n,                                \
 	};                                                                                         \
@@ -243,6 +361,9 @@ static const struct led_strip_driver_api led_strip_remap_api = {
 		DT_INST_FOREACH_CHILD_VARGS(n, LED_STRIP_REMAP_INDICATOR, n)                       \
 	};                                                                                         \
                                                                                                    \
+	BUILD_ASSERT(ARRAY_SIZE(led_strip_remap_indicators_##n) <= 32,                            \
+		     "Too many indicators to track as dirty");                                     \
+                                                                                                   \
 	static const struct led_strip_remap_config led_strip_remap_config_##n = {                  \
 		.chain_length = DT_INST_PROP(n, chain_length),                                     \
 		.led_strip = DEVICE_DT_GET(DT_INST_PHANDLE(n, led_strip)),                         \
@@ -10,7 +10,9 @@
 #include <zephyr/drivers/spi.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/atomic.h>
 #include <zephyr/sys/util_macro.h>
+#include <string.h>
 
 #include <knob/math.h>
 #include <knob/drivers/encoder.h>
@@ -28,11 +30,41 @@ LOG_MODULE_REGISTER(as5047, CONFIG_ZMK_LOG_LEVEL);
 #define RW_WRITE 0
 #define RW_READ 1
 
+// Samples older than this are read again synchronously, a few ticks of the control loop
+#define AS5047_ASYNC_MAX_AGE_US 1000
+
 struct as5047_config {
 	struct spi_dt_spec bus;
 	uint32_t init_delay_us;
 };
 
+#ifdef CONFIG_KNOB_ENCODER_AS5047_ASYNC
+struct as5047_sample {
+	uint16_t angle;
+	int16_t error;
+	uint32_t timestamp;
+};
+#endif /* CONFIG_KNOB_ENCODER_AS5047_ASYNC */
+
+struct as5047_data {
+	float radian;
+	struct encoder_stats stats;
+
+#ifdef CONFIG_KNOB_ENCODER_AS5047_ASYNC
+	struct as5047_sample samples[2];
+	volatile uint8_t front;
+	atomic_t busy;
+	uint32_t start_cycles;
+
+	uint16_t tx;
+	uint16_t rx;
+	struct spi_buf tx_buf;
+	struct spi_buf rx_buf;
+	struct spi_buf_set tx_bufs;
+	struct spi_buf_set rx_bufs;
+#endif /* CONFIG_KNOB_ENCODER_AS5047_ASYNC */
+};
+
 static inline uint8_t as5047_calc_parc(uint16_t command)
 {
 	uint8_t parc = 0;
@@ -44,6 +76,64 @@ static inline uint8_t as5047_calc_parc(uint16_t command)
 	return parc & 0x1;
 }
 
+static inline uint16_t as5047_make_request(uint16_t addr, uint8_t rw)
+{
+	uint16_t req;
+
+	req = (addr & BIT_MASK(14)) | ((rw & BIT_MASK(1)) << 14);
+	req |= as5047_calc_parc(req) << 15;
+
+	return sys_cpu_to_be16(req);
+}
+
+static int as5047_parse_response(uint16_t res, uint16_t *val)
+{
+	res = sys_be16_to_cpu(res);
+
+	if ((res >> 14) & BIT_MASK(1)) {
+		return -EIO;
+	}
+
+	if ((res >> 15) != as5047_calc_parc(res & BIT_MASK(15))) {
+		return -EBADMSG;
+	}
+
+	*val = res & BIT_MASK(14);
+
+	return 0;
+}
+
+static void as5047_count_result(struct as5047_data *data, int ret)
+{
+	switch (ret) {
+	case 0:
+		data->stats.reads++;
+		break;
+	case -EIO:
+		data->stats.flag_errors++;
+		break;
+	case -EBADMSG:
+		data->stats.parity_errors++;
+		break;
+	default:
+		data->stats.bus_errors++;
+		break;
+	}
+}
+
+static void as5047_count_latency(struct as5047_data *data, uint32_t start_cycles)
+{
+	uint32_t latency = k_cyc_to_us_floor32(k_cycle_get_32() - start_cycles);
+
+	data->stats.latency_us_last = latency;
+	data->stats.latency_us_max = MAX(data->stats.latency_us_max, latency);
+}
+
+static inline float as5047_to_radian(uint16_t val)
+{
+	return (float)val * PI2 / (float)BIT(14);
+}
+
 static int as5047_send_command(const struct device *dev, uint16_t addr, uint8_t rw, uint16_t *val)
 {
 	const struct as5047_config *config = dev->config;
@@ -51,10 +141,7 @@ static int as5047_send_command(const struct device *dev, uint16_t addr, uint8_t
 	int ret;
 	uint16_t req, res = 0;
 
-	req = (addr & BIT_MASK(14)) | ((rw & BIT_MASK(1)) << 14);
-	req |= as5047_calc_parc(req) << 15;
-
-	req = sys_cpu_to_be16(req);
+	req = as5047_make_request(addr, rw);
 
 	const struct spi_buf tx_buf = {
 		.buf = &req,
@@ -79,32 +166,109 @@ static int as5047_send_command(const struct device *dev, uint16_t addr, uint8_t
 		return ret;
 	}
 
-	res = sys_be16_to_cpu(res);
+	return as5047_parse_response(res, val);
+}
 
-	if ((res >> 14) & BIT_MASK(1)) {
-		return EIO;
+static void as5047_read_radian(const struct device *dev)
+{
+	struct as5047_data *data = dev->data;
+	uint32_t start_cycles = k_cycle_get_32();
+	uint16_t val = 0;
+	int ret;
+
+	ret = as5047_send_command(dev, ADDR_ANGLECOM, RW_READ, &val);
+	as5047_count_result(data, ret);
+	as5047_count_latency(data, start_cycles);
+
+	// Keep the last good angle instead of jumping to zero on error
+	if (ret == 0) {
+		data->radian = as5047_to_radian(val);
 	}
+}
 
-	if ((res >> 15) != as5047_calc_parc(res & BIT_MASK(15))) {
-		return EIO;
+#ifdef CONFIG_KNOB_ENCODER_AS5047_ASYNC
+static void as5047_async_cb(const struct device *spi, int result, void *user_data)
+{
+	const struct device *dev = user_data;
+	struct as5047_data *data = dev->data;
+	ARG_UNUSED(spi);
+
+	uint8_t back = !data->front;
+	struct as5047_sample *sample = &data->samples[back];
+
+	sample->error = result;
+	if (result == 0) {
+		sample->error = as5047_parse_response(data->rx, &sample->angle);
 	}
+	sample->timestamp = k_cycle_get_32();
 
-	*val = res & BIT_MASK(14);
+	as5047_count_result(data, sample->error);
+	as5047_count_latency(data, data->start_cycles);
 
-	return ret;
+	data->front = back;
+	atomic_clear(&data->busy);
 }
 
 static float as5047_get_radian(const struct device *dev)
 {
-	uint16_t val = 0;
-	as5047_send_command(dev, ADDR_ANGLECOM, RW_READ, &val);
+	const struct as5047_config *config = dev->config;
+	struct as5047_data *data = dev->data;
+	int ret;
 
-	return (float)val * PI2 / (float)BIT(14);
+	if (!atomic_cas(&data->busy, 0, 1)) {
+		// The front buffer has not changed since the previous call
+		data->stats.overruns++;
+		return data->radian;
+	}
+
+	// No transfer is in flight from here on, so the front buffer is stable
+	const struct as5047_sample *sample = &data->samples[data->front];
+	if (k_cyc_to_us_floor32(k_cycle_get_32() - sample->timestamp) > AS5047_ASYNC_MAX_AGE_US) {
+		// Outside of the control loop, e.g. while calibrating, the latest sample may be
+		// from before a long sleep. Read on the spot then, like the synchronous mode does.
+		as5047_read_radian(dev);
+	} else if (sample->error == 0) {
+		// Take the latest completed sample, never wait for the bus
+		data->radian = as5047_to_radian(sample->angle);
+	}
+
+	data->start_cycles = k_cycle_get_32();
+	ret = spi_transceive_cb(config->bus.bus, &config->bus.config, &data->tx_bufs,
+				&data->rx_bufs, as5047_async_cb, (void *)dev);
+	if (ret < 0) {
+		as5047_count_result(data, ret);
+		atomic_clear(&data->busy);
+	}
+
+	return data->radian;
+}
+#else
+static float as5047_get_radian(const struct device *dev)
+{
+	struct as5047_data *data = dev->data;
+
+	as5047_read_radian(dev);
+
+	return data->radian;
+}
+#endif /* CONFIG_KNOB_ENCODER_AS5047_ASYNC */
+
+static int as5047_get_stats(const struct device *dev, struct encoder_stats *stats)
+{
+	struct as5047_data *data = dev->data;
+	unsigned int key = irq_lock();
+
+	memcpy(stats, &data->stats, sizeof(struct encoder_stats));
+
+	irq_unlock(key);
+
+	return 0;
 }
 
 static int as5047_init(const struct device *dev)
 {
 	const struct as5047_config *config = dev->config;
+	struct as5047_data *data = dev->data;
 
 	if (!device_is_ready(config->bus.bus)) {
 		LOG_ERR("SPI bus is not ready: %s", config->bus.bus->name);
@@ -115,14 +279,40 @@ static int as5047_init(const struct device *dev)
 		k_usleep(config->init_delay_us);
 	}
 
+#ifdef CONFIG_KNOB_ENCODER_AS5047_ASYNC
+	data->tx = as5047_make_request(ADDR_ANGLECOM, RW_READ);
+
+	data->tx_buf.buf = &data->tx;
+	data->tx_buf.len = sizeof(data->tx);
+	data->tx_bufs.buffers = &data->tx_buf;
+	data->tx_bufs.count = 1U;
+
+	data->rx_buf.buf = &data->rx;
+	data->rx_buf.len = sizeof(data->rx);
+	data->rx_bufs.buffers = &data->rx_buf;
+	data->rx_bufs.count = 1U;
+
+	// Seed the front buffer so that the first read has something to return. The response
+	// always belongs to the previous frame, so the first one is dropped.
+	struct as5047_sample *sample = &data->samples[data->front];
+	as5047_send_command(dev, ADDR_ANGLECOM, RW_READ, &sample->angle);
+	sample->error = as5047_send_command(dev, ADDR_ANGLECOM, RW_READ, &sample->angle);
+	sample->timestamp = k_cycle_get_32();
+#else
+	ARG_UNUSED(data);
+#endif /* CONFIG_KNOB_ENCODER_AS5047_ASYNC */
+
 	return 0;
 }
 
 static const struct encoder_driver_api as5047_driver_api = {
 	.get_radian = as5047_get_radian,
+	.get_stats = as5047_get_stats,
 };
 
 #define AS5047_INST(n)                                                                             \
+	static struct as5047_data as5047_data_##n;                                                 \
+                                                                                                   \
 	static const struct as5047_config as5047_config_##n = {                                    \
 		.bus = SPI_DT_SPEC_INST_GET(n,                                                     \
 					    SPI_OP_MODE_MASTER | SPI_TRANSFER_MSB |                \
@@ -131,7 +321,7 @@ static const struct encoder_driver_api as5047_driver_api = {
 		.init_delay_us = DT_INST_PROP_OR(n, init_delay_us, 0),                             \
 	};                                                                                         \
                                                                                                    \
-	DEVICE_DT_INST_DEFINE(n, as5047_init, NULL, NULL, &as5047_config_##n, POST_KERNEL,         \
-			      CONFIG_KNOB_DRIVER_INIT_PRIORITY, &as5047_driver_api);
+	DEVICE_DT_INST_DEFINE(n, as5047_init, NULL, &as5047_data_##n, &as5047_config_##n,          \
+			      POST_KERNEL, CONFIG_KNOB_DRIVER_INIT_PRIORITY, &as5047_driver_api);
 
 DT_INST_FOREACH_STATUS_OKAY(AS5047_INST)
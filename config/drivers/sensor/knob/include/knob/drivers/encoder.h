@@ -18,10 +18,31 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Read statistics of an encoder
+ */
+struct encoder_stats {
+	/** Completed reads */
+	uint32_t reads;
+	/** Reads failed on the bus */
+	uint32_t bus_errors;
+	/** Responses with bad parity */
+	uint32_t parity_errors;
+	/** Responses with the error flag set */
+	uint32_t flag_errors;
+	/** Reads skipped because the previous one was still in flight */
+	uint32_t overruns;
+	/** Latency of the last read, in microseconds */
+	uint32_t latency_us_last;
+	/** Maximum latency of reads, in microseconds */
+	uint32_t latency_us_max;
+};
+
 /** @cond INTERNAL_HIDDEN */
 
 struct encoder_driver_api {
 	float (*get_radian)(const struct device *dev);
+	int (*get_stats)(const struct device *dev, struct encoder_stats *stats);
 };
 
 /** @endcond */
@@ -39,6 +60,26 @@ static inline float encoder_get_radian(const struct device *dev)
 	return api->get_radian(dev);
 }
 
+/**
+ * @brief Get read statistics
+ *
+ * @param dev Encoder instance
+ * @param stats Statistics to be filled
+ *
+ * @retval 0 If successful.
+ * @retval -ENOTSUP If not supported by the encoder.
+ */
+static inline int encoder_get_stats(const struct device *dev, struct encoder_stats *stats)
+{
+	const struct encoder_driver_api *api = (const struct encoder_driver_api *)dev->api;
+
+	if (api->get_stats == NULL) {
+		return -ENOTSUP;
+	}
+
+	return api->get_stats(dev, stats);
+}
+
 /**
  * @}
  */
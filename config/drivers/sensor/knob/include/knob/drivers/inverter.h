@@ -18,12 +18,22 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Callback invoked from the PWM timer interrupt
+ *
+ * @param dev Inverter instance
+ * @param user_data User data passed to inverter_set_update_handler()
+ */
+typedef void (*inverter_update_handler_t)(const struct device *dev, void *user_data);
+
 /** @cond INTERNAL_HIDDEN */
 
 struct inverter_driver_api {
 	void (*start)(const struct device *dev);
 	void (*stop)(const struct device *dev);
 	void (*set_powers)(const struct device *dev, float a, float b, float c);
+	int (*set_update_handler)(const struct device *dev, uint32_t interval_us,
+				  inverter_update_handler_t handler, void *user_data);
 };
 
 /** @endcond */
@@ -67,6 +77,32 @@ static inline void inverter_set_powers(const struct device *dev, float a, float
 	return api->set_powers(dev, a, b, c);
 }
 
+/**
+ * @brief Get notified from the PWM timer update event at a fixed rate.
+ *
+ * The handler runs in interrupt context and is only called while the inverter is started.
+ *
+ * @param dev Inverter instance
+ * @param interval_us Desired interval between two calls, rounded to whole PWM half periods
+ * @param handler Callback, or NULL to disable
+ * @param user_data User data passed to the callback
+ *
+ * @retval 0 If successful.
+ * @retval -ENOTSUP If not supported by the inverter.
+ * @retval -EINVAL If the interval is not achievable.
+ */
+static inline int inverter_set_update_handler(const struct device *dev, uint32_t interval_us,
+					      inverter_update_handler_t handler, void *user_data)
+{
+	const struct inverter_driver_api *api = (const struct inverter_driver_api *)dev->api;
+
+	if (api->set_update_handler == NULL) {
+		return -ENOTSUP;
+	}
+
+	return api->set_update_handler(dev, interval_us, handler, user_data);
+}
+
 /**
  * @}
  */
@@ -6,6 +6,7 @@
 #ifndef KNOB_INCLUDE_DRIVERS_KNOB_H_
 #define KNOB_INCLUDE_DRIVERS_KNOB_H_
 
+#include <stdint.h>
 #include <stdbool.h>
 #include <zephyr/device.h>
 
@@ -33,6 +34,16 @@ struct knob_params {
 	int ppr;
 };
 
+#define KNOB_LOOP_STATS_BUCKETS 16
+
+struct knob_loop_stats {
+	uint32_t count;
+	uint32_t min_us;
+	uint32_t max_us;
+	uint32_t bucket_us;
+	uint32_t histogram[KNOB_LOOP_STATS_BUCKETS];
+};
+
 void knob_set_mode(const struct device *dev, enum knob_mode mode);
 
 enum knob_mode knob_get_mode(const struct device *dev);
@@ -55,6 +66,10 @@ float knob_get_position(const struct device *dev);
 
 float knob_get_velocity(const struct device *dev);
 
+int knob_get_loop_stats(const struct device *dev, struct knob_loop_stats *stats);
+
+void knob_reset_loop_stats(const struct device *dev);
+
 #ifdef __cplusplus
 }
 #endif
@@ -9,6 +9,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <zephyr/device.h>
+#include <zephyr/kernel.h>
 
 /**
  * @file
@@ -30,6 +31,15 @@ struct motor_control {
 	float target;
 };
 
+struct motor_sample {
+	uint32_t timestamp;
+	float raw_angle;
+	float angle;
+	float raw_velocity;
+	float velocity;
+	float electrical_angle;
+};
+
 enum motor_direction {
 	CW = 1,
 	CCW = -1,
@@ -39,12 +49,97 @@ enum motor_direction {
 int motor_calibrate_set(const struct device *dev, float zero_offset,
 			enum motor_direction direction);
 
+int motor_calibrate_get(const struct device *dev, float *zero_offset,
+			enum motor_direction *direction);
+
 int motor_calibrate_auto(const struct device *dev);
 
+/**
+ * @brief Check the calibration set by motor_calibrate_set() against the motor
+ *
+ * Holds the rotor at two electrical angles, which takes less than 100 ms, and compares where it
+ * settles with the zero offset and direction.
+ *
+ * @param[in] dev  Motor device
+ *
+ * @return 0 if matched, -EINVAL if not calibrated, -EIO on mismatch
+ */
+int motor_calibrate_verify(const struct device *dev);
+
+#define MOTOR_ENCODER_COMP_SIZE 64
+
+/**
+ * @brief Get the encoder angle correction table captured by motor_calibrate_auto()
+ *
+ * @param[in] dev    Motor device
+ * @param[out] comp  MOTOR_ENCODER_COMP_SIZE entries
+ *
+ * @return 0 on success, -ENODATA if not captured, -ENOTSUP if not enabled
+ */
+int motor_encoder_comp_get(const struct device *dev, int16_t *comp);
+
+/**
+ * @brief Restore an encoder angle correction table, so that calibration does not capture it
+ *
+ * @param[in] dev   Motor device
+ * @param[in] comp  MOTOR_ENCODER_COMP_SIZE entries, or NULL to capture again
+ *
+ * @return 0 on success, -ENOTSUP if not enabled
+ */
+int motor_encoder_comp_set(const struct device *dev, const int16_t *comp);
+
+#define MOTOR_ANTICOGGING_SIZE 512
+
+/**
+ * @brief Measure the voltage holding the rotor at evenly spaced positions over a revolution
+ *
+ * Drives the rotor through a full revolution and back with its own position loop, taking
+ * MOTOR_ANTICOGGING_SIZE steps each way, which takes about 30 s. The control loop is paused
+ * meanwhile, and adds the interpolated table to its output afterwards.
+ *
+ * @param[in] dev  Motor device
+ *
+ * @return 0 on success, -EINVAL if not calibrated, -EIO if the rotor did not follow,
+ *         -ENOTSUP if not enabled
+ */
+int motor_calibrate_anticogging(const struct device *dev);
+
+/**
+ * @brief Get the anti-cogging table captured by motor_calibrate_anticogging()
+ *
+ * @param[in] dev     Motor device
+ * @param[out] table  MOTOR_ANTICOGGING_SIZE entries in mV, the first at encoder angle 0
+ *
+ * @return 0 on success, -ENODATA if not captured, -ENOTSUP if not enabled
+ */
+int motor_anticogging_get(const struct device *dev, int16_t *table);
+
+/**
+ * @brief Restore an anti-cogging table
+ *
+ * @param[in] dev    Motor device
+ * @param[in] table  MOTOR_ANTICOGGING_SIZE entries in mV, or NULL to stop compensating
+ *
+ * @return 0 on success, -ENOTSUP if not enabled
+ */
+int motor_anticogging_set(const struct device *dev, const int16_t *table);
+
 bool motor_is_calibrated(const struct device *dev);
 
 void motor_tick(const struct device *dev);
 
+/**
+ * @brief Give `sem` from the PWM timer every `interval_us`, to pace motor_tick() by
+ *
+ * @param[in] dev          Motor device
+ * @param[in] interval_us  Interval between two ticks
+ * @param[in] sem          Semaphore to give, or NULL to stop
+ *
+ * @return 0 on success, -ENOTSUP if CONFIG_KNOB_TIMER_TRIGGER is not enabled, or error from
+ *         the inverter
+ */
+int motor_set_tick_trigger(const struct device *dev, uint32_t interval_us, struct k_sem *sem);
+
 void motor_set_enable(const struct device *dev, bool enable);
 
 void motor_set_torque_limit(const struct device *dev, float limit);
@@ -55,6 +150,8 @@ void motor_set_angle_pid(const struct device *dev, float p, float i, float d);
 
 void motor_set_velocity_pid(const struct device *dev, float p, float i, float d);
 
+const struct motor_sample *motor_get_sample(const struct device *dev);
+
 float motor_get_estimate_angle(const struct device *dev);
 
 float motor_get_estimate_velocity(const struct device *dev);
@@ -77,6 +174,13 @@ struct motor_state {
 
 void motor_inspect(const struct device *dev, struct motor_state *state);
 
+int motor_trace_start(const struct device *dev, uint32_t decimation);
+
+void motor_trace_stop(const struct device *dev);
+
+int motor_trace_read(const struct device *dev, struct motor_state *states, int max,
+		     uint32_t *dropped);
+
 #ifdef __cplusplus
 }
 #endif
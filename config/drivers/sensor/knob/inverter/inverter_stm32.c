@@ -12,6 +12,7 @@
 #include <zephyr/sys/util_macro.h>
 
 #include <soc.h>
+#include <stm32_ll_rcc.h>
 #include <stm32_ll_tim.h>
 
 #include <knob/drivers/inverter.h>
@@ -29,6 +30,10 @@ static const uint32_t timer_channels[] = {
 
 struct inverter_stm32_data {
 	TIM_HandleTypeDef th;
+#ifdef CONFIG_KNOB_INVERTER_STM32_UPDATE_IRQ
+	inverter_update_handler_t update_handler;
+	void *update_user_data;
+#endif /* CONFIG_KNOB_INVERTER_STM32_UPDATE_IRQ */
 };
 
 struct inverter_stm32_config {
@@ -36,6 +41,9 @@ struct inverter_stm32_config {
 	TIM_TypeDef *timer;
 	int pwm_period;
 	int pwm_channels[3];
+#ifdef CONFIG_KNOB_INVERTER_STM32_UPDATE_IRQ
+	void (*irq_config_func)(const struct device *dev);
+#endif /* CONFIG_KNOB_INVERTER_STM32_UPDATE_IRQ */
 };
 
 static void inverter_stm32_set_powers(const struct device *dev, float va, float vb, float vc);
@@ -92,6 +100,74 @@ static void inverter_stm32_set_powers(const struct device *dev, float a, float b
 	__HAL_TIM_SET_COMPARE(&data->th, TIM_CHANNEL(config, 2), config->pwm_period * c);
 }
 
+#ifdef CONFIG_KNOB_INVERTER_STM32_UPDATE_IRQ
+static uint32_t inverter_stm32_get_clock(void)
+{
+	/* Advanced-control timers (TIM1/TIM8) are clocked from APB2, doubled if prescaled */
+	uint32_t clk = HAL_RCC_GetPCLK2Freq();
+
+	if (LL_RCC_GetAPB2Prescaler() != LL_RCC_APB2_DIV_1) {
+		clk *= 2;
+	}
+
+	return clk;
+}
+
+static int inverter_stm32_set_update_handler(const struct device *dev, uint32_t interval_us,
+					     inverter_update_handler_t handler, void *user_data)
+{
+	struct inverter_stm32_data *data = dev->data;
+	const struct inverter_stm32_config *config = dev->config;
+	unsigned int key;
+
+	if (handler == NULL) {
+		LL_TIM_DisableIT_UPDATE(config->timer);
+		data->update_handler = NULL;
+		return 0;
+	}
+
+	/*
+	 * In center-aligned mode the update event is generated on both overflow and underflow,
+	 * so each event is one half PWM period. The repetition counter skips the ones between.
+	 */
+	uint64_t ticks = (uint64_t)inverter_stm32_get_clock() * interval_us / USEC_PER_SEC;
+	uint32_t events = DIV_ROUND_CLOSEST(ticks, config->pwm_period);
+	if (events < 1 || events > BIT(8)) {
+		LOG_ERR("%s: Unsupported update interval: %u us", dev->name, interval_us);
+		return -EINVAL;
+	}
+
+	key = irq_lock();
+	data->update_handler = handler;
+	data->update_user_data = user_data;
+	irq_unlock(key);
+
+	LL_TIM_SetRepetitionCounter(config->timer, events - 1);
+	LL_TIM_ClearFlag_UPDATE(config->timer);
+	LL_TIM_EnableIT_UPDATE(config->timer);
+
+	LOG_DBG("%s: Update event every %u half periods", dev->name, events);
+
+	return 0;
+}
+
+static void inverter_stm32_isr(const struct device *dev)
+{
+	struct inverter_stm32_data *data = dev->data;
+	const struct inverter_stm32_config *config = dev->config;
+
+	if (!LL_TIM_IsActiveFlag_UPDATE(config->timer)) {
+		return;
+	}
+
+	LL_TIM_ClearFlag_UPDATE(config->timer);
+
+	if (data->update_handler != NULL) {
+		data->update_handler(dev, data->update_user_data);
+	}
+}
+#endif /* CONFIG_KNOB_INVERTER_STM32_UPDATE_IRQ */
+
 static int inverter_stm32_init(const struct device *dev)
 {
 	struct inverter_stm32_data *data = dev->data;
@@ -159,6 +235,10 @@ static int inverter_stm32_init(const struct device *dev)
 		return -EIO;
 	}
 
+#ifdef CONFIG_KNOB_INVERTER_STM32_UPDATE_IRQ
+	config->irq_config_func(dev);
+#endif /* CONFIG_KNOB_INVERTER_STM32_UPDATE_IRQ */
+
 	return 0;
 }
 
@@ -166,16 +246,37 @@ static const struct inverter_driver_api inverter_stm32_driver_api = {
 	.start = inverter_stm32_start,
 	.stop = inverter_stm32_stop,
 	.set_powers = inverter_stm32_set_powers,
+#ifdef CONFIG_KNOB_INVERTER_STM32_UPDATE_IRQ
+	.set_update_handler = inverter_stm32_set_update_handler,
+#endif /* CONFIG_KNOB_INVERTER_STM32_UPDATE_IRQ */
 };
 
+#ifdef CONFIG_KNOB_INVERTER_STM32_UPDATE_IRQ
+#define INVERTER_STM32_IRQ_CONFIG(n)                                                               \
+	static void inverter_stm32_irq_config_##n(const struct device *dev)                        \
+	{                                                                                          \
+		IRQ_CONNECT(DT_IRQ_BY_NAME(DT_INST_PARENT(n), up, irq),                            \
+			    DT_IRQ_BY_NAME(DT_INST_PARENT(n), up, priority), inverter_stm32_isr,   \
+			    DEVICE_DT_INST_GET(n), 0);                                             \
+		irq_enable(DT_IRQ_BY_NAME(DT_INST_PARENT(n), up, irq));                            \
+	}
+#define INVERTER_STM32_IRQ_CONFIG_INIT(n) .irq_config_func = inverter_stm32_irq_config_##n,
+#else
+#define INVERTER_STM32_IRQ_CONFIG(n)
+#define INVERTER_STM32_IRQ_CONFIG_INIT(n)
+#endif /* CONFIG_KNOB_INVERTER_STM32_UPDATE_IRQ */
+
 #define INVERTER_STM32_INST(n)                                                                     \
 	struct inverter_stm32_data inverter_stm32_data_##n;                                        \
                                                                                                    \
+	INVERTER_STM32_IRQ_CONFIG(n)                                                               \
+                                                                                                   \
 	static const struct inverter_stm32_config inverter_stm32_config_##n = {                    \
 		.enable_gpio = GPIO_DT_SPEC_INST_GET_OR(n, enable_gpios, { 0 }),                   \
 		.timer = (TIM_TypeDef *)DT_REG_ADDR(DT_INST_PARENT(n)),                            \
 		.pwm_period = DT_INST_PROP(n, pwm_period),                                         \
 		.pwm_channels = DT_INST_PROP(n, pwm_channels),                                     \
+		INVERTER_STM32_IRQ_CONFIG_INIT(n)                                                  \
 	};                                                                                         \
                                                                                                    \
 	DEVICE_DT_INST_DEFINE(n, inverter_stm32_init, NULL, &inverter_stm32_data_##n,              \
@@ -8,6 +8,7 @@
 #include <zephyr/device.h>
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/sensor.h>
+#include <string.h>
 
 #include <knob/math.h>
 #include <knob/encoder_state.h>
@@ -41,11 +42,22 @@ struct knob_data {
 
 	bool encoder_report;
 	int encoder_ppr;
+
+#ifdef CONFIG_KNOB_TIMER_TRIGGER
+	struct k_sem tick_sem;
+#endif /* CONFIG_KNOB_TIMER_TRIGGER */
+
+#ifdef CONFIG_KNOB_LOOP_STATS
+	struct k_spinlock loop_stats_lock;
+	struct knob_loop_stats loop_stats;
+	uint32_t loop_cycle_last;
+#endif /* CONFIG_KNOB_LOOP_STATS */
 };
 
 struct knob_config {
 	const struct device *motor;
 	uint32_t tick_interval_us;
+	uint32_t profile_decimation;
 	const struct device **profiles;
 	uint32_t profiles_cnt;
 };
@@ -189,6 +201,111 @@ static void knob_report_work_handler(struct k_work *work)
 	}
 }
 
+#ifdef CONFIG_KNOB_LOOP_STATS
+static void knob_loop_stats_update(struct knob_data *data)
+{
+	uint32_t now = k_cycle_get_32();
+	k_spinlock_key_t key = k_spin_lock(&data->loop_stats_lock);
+
+	if (data->loop_cycle_last != 0) {
+		struct knob_loop_stats *stats = &data->loop_stats;
+		uint32_t period = k_cyc_to_us_floor32(now - data->loop_cycle_last);
+		uint32_t bucket = MIN(period / CONFIG_KNOB_LOOP_STATS_BUCKET_US,
+				      KNOB_LOOP_STATS_BUCKETS - 1);
+
+		stats->histogram[bucket]++;
+		stats->min_us = stats->count == 0 ? period : MIN(stats->min_us, period);
+		stats->max_us = MAX(stats->max_us, period);
+		stats->count++;
+	}
+
+	data->loop_cycle_last = now;
+
+	k_spin_unlock(&data->loop_stats_lock, key);
+}
+#endif /* CONFIG_KNOB_LOOP_STATS */
+
+int knob_get_loop_stats(const struct device *dev, struct knob_loop_stats *stats)
+{
+#ifdef CONFIG_KNOB_LOOP_STATS
+	struct knob_data *data = dev->data;
+	k_spinlock_key_t key = k_spin_lock(&data->loop_stats_lock);
+
+	memcpy(stats, &data->loop_stats, sizeof(struct knob_loop_stats));
+	stats->bucket_us = CONFIG_KNOB_LOOP_STATS_BUCKET_US;
+
+	k_spin_unlock(&data->loop_stats_lock, key);
+
+	return 0;
+#else
+	ARG_UNUSED(dev);
+	ARG_UNUSED(stats);
+	return -ENOTSUP;
+#endif /* CONFIG_KNOB_LOOP_STATS */
+}
+
+void knob_reset_loop_stats(const struct device *dev)
+{
+#ifdef CONFIG_KNOB_LOOP_STATS
+	struct knob_data *data = dev->data;
+	k_spinlock_key_t key = k_spin_lock(&data->loop_stats_lock);
+
+	memset(&data->loop_stats, 0, sizeof(struct knob_loop_stats));
+	data->loop_cycle_last = 0;
+
+	k_spin_unlock(&data->loop_stats_lock, key);
+#else
+	ARG_UNUSED(dev);
+#endif /* CONFIG_KNOB_LOOP_STATS */
+}
+
+static void knob_wait_tick(const struct device *dev)
+{
+	const struct knob_config *config = dev->config;
+
+#ifdef CONFIG_KNOB_TIMER_TRIGGER
+	struct knob_data *data = dev->data;
+
+	// The PWM timer halts while the inverter is stopped, fall back to a slower pace then
+	k_sem_take(&data->tick_sem, K_USEC(config->tick_interval_us * 2));
+#else
+	k_usleep(config->tick_interval_us);
+#endif /* CONFIG_KNOB_TIMER_TRIGGER */
+}
+
+static void knob_profile_stage(const struct device *dev)
+{
+	struct knob_data *data = dev->data;
+
+	float p;
+
+	if (data->position_min != data->position_max) {
+		p = knob_get_position(dev);
+		if (p > data->position_max) {
+			data->mc->mode = ANGLE;
+			data->mc->target = data->position_max;
+			return;
+		} else if (p < data->position_min) {
+			data->mc->mode = ANGLE;
+			data->mc->target = data->position_min;
+			return;
+		}
+	}
+
+	knob_profile_tick(data->profile, data->mc);
+}
+
+static void knob_report_stage(const struct device *dev)
+{
+	struct knob_data *data = dev->data;
+
+	data->delta = 0;
+	if (data->encoder_report && knob_profile_report(data->profile, &data->delta) == 0 &&
+	    data->delta != 0) {
+		k_work_submit(&data->report_work);
+	}
+}
+
 static void knob_thread(void *p1, void *p2, void *p3)
 {
 	const struct device *dev = (const struct device *)p1;
@@ -198,39 +315,33 @@ static void knob_thread(void *p1, void *p2, void *p3)
 	struct knob_data *data = dev->data;
 	const struct knob_config *config = dev->config;
 
-	float p;
-	bool limited = false;
+	uint32_t ticks = 0;
+	bool slow_tick;
 
 	while (1) {
-		if (data->profile != NULL) {
-			limited = false;
-			if (data->position_min != data->position_max) {
-				p = knob_get_position(dev);
-				if (p > data->position_max) {
-					data->mc->mode = ANGLE;
-					data->mc->target = data->position_max;
-					limited = true;
-				} else if (p < data->position_min) {
-					data->mc->mode = ANGLE;
-					data->mc->target = data->position_min;
-					limited = true;
-				}
-			}
-			if (!limited) {
-				knob_profile_tick(data->profile, data->mc);
-			}
-
-			motor_tick(config->motor);
-
-			data->delta = 0;
-			if (data->encoder_report &&
-			    knob_profile_report(data->profile, &data->delta) == 0 &&
-			    data->delta != 0) {
-				k_work_submit(&data->report_work);
-			}
+		knob_wait_tick(dev);
+
+#ifdef CONFIG_KNOB_LOOP_STATS
+		knob_loop_stats_update(data);
+#endif /* CONFIG_KNOB_LOOP_STATS */
+
+		if (data->profile == NULL) {
+			continue;
+		}
+
+		// Profile and report run at a decimated rate, FOC output runs on every tick
+		slow_tick = ticks == 0;
+		ticks = (ticks + 1) % config->profile_decimation;
+
+		if (slow_tick) {
+			knob_profile_stage(dev);
 		}
 
-		k_usleep(config->tick_interval_us);
+		motor_tick(config->motor);
+
+		if (slow_tick) {
+			knob_report_stage(dev);
+		}
 	}
 }
 
@@ -254,6 +365,16 @@ int knob_init(const struct device *dev)
 
 	data->params.ppr = data->encoder_ppr;
 
+#ifdef CONFIG_KNOB_TIMER_TRIGGER
+	k_sem_init(&data->tick_sem, 0, 1);
+
+	int ret = motor_set_tick_trigger(config->motor, config->tick_interval_us, &data->tick_sem);
+	if (ret < 0) {
+		LOG_ERR("%s: Failed to set up timer trigger: %d", dev->name, ret);
+		return ret;
+	}
+#endif /* CONFIG_KNOB_TIMER_TRIGGER */
+
 	k_thread_create(&data->thread, data->thread_stack, CONFIG_KNOB_THREAD_STACK_SIZE,
 			(k_thread_entry_t)knob_thread, (void *)dev, 0, NULL,
 			K_PRIO_COOP(CONFIG_KNOB_THREAD_PRIORITY), 0, K_NO_WAIT);
@@ -280,6 +401,7 @@ int knob_init(const struct device *dev)
 	static const struct knob_config knob_config_##n = {                                        \
 		.motor = DEVICE_DT_GET(DT_INST_PHANDLE(n, motor)),                                 \
 		.tick_interval_us = DT_INST_PROP_OR(n, tick_interval_us, 200),                     \
+		.profile_decimation = MAX(DT_INST_PROP_OR(n, profile_decimation, 1), 1),           \
 		.profiles = knob_profiles_##n,                                                     \
 		.profiles_cnt = ARRAY_SIZE(knob_profiles_##n),                                     \
 	};                                                                                         \
@@ -32,11 +32,36 @@ void encoder_init(struct encoder_state *state, const struct device *dev)
 	state->angle_time = time_us();
 }
 
+static float encoder_compensate(const int16_t *comp, float angle)
+{
+	float pos = angle * (ENCODER_COMP_SIZE / PI2);
+	int i = (int)pos;
+	float frac = pos - (float)i;
+
+	i &= ENCODER_COMP_SIZE - 1;
+	int16_t a = comp[i];
+	int16_t b = comp[(i + 1) & (ENCODER_COMP_SIZE - 1)];
+
+	angle += ((float)a + (float)(b - a) * frac) * ENCODER_COMP_UNIT;
+
+	if (angle < 0.0f) {
+		angle += PI2;
+	} else if (angle >= PI2) {
+		angle -= PI2;
+	}
+
+	return angle;
+}
+
 void encoder_update(struct encoder_state *state, const struct device *dev)
 {
 	float angle = encoder_get_radian(dev);
 	state->angle_time = time_us();
 
+	if (state->comp != NULL) {
+		angle = encoder_compensate(state->comp, angle);
+	}
+
 	float angle_delta = angle - state->angle_last;
 
 	// If overflow happened track it as full rotation
@@ -57,8 +82,35 @@ float encoder_get_full_angle(struct encoder_state *state)
 	return (float)state->rotation_count * PI2 + state->angle_last;
 }
 
+static float encoder_get_velocity_pll(struct encoder_state *state)
+{
+	float angle = encoder_get_full_angle(state);
+	float time_delta = (float)(state->angle_time - state->velocity_time) * 1e-6f;
+
+	state->velocity_time = state->angle_time;
+
+	// Lock again from the current angle if the encoder was not sampled for a while
+	if (time_delta <= 0 || time_delta > 0.1f) {
+		state->pll_angle = angle;
+		state->pll_velocity = 0.0f;
+		return 0.0f;
+	}
+
+	// Predict, then correct both angle and velocity by the phase error
+	state->pll_angle += time_delta * state->pll_velocity;
+	float error = angle - state->pll_angle;
+	state->pll_angle += time_delta * state->pll_kp * error;
+	state->pll_velocity += time_delta * state->pll_ki * error;
+
+	return state->pll_velocity;
+}
+
 float encoder_get_velocity(struct encoder_state *state)
 {
+	if (state->pll_kp > 0) {
+		return encoder_get_velocity_pll(state);
+	}
+
 	int32_t rotation_count_delta = state->rotation_count - state->rotation_count_last;
 	float angle_delta = state->angle_last - state->velocity_last;
 	float time_delta = (float)(state->angle_time - state->velocity_time) * 1e-6f;
@@ -75,3 +127,19 @@ float encoder_get_velocity(struct encoder_state *state)
 
 	return velocity;
 }
+
+// Correct raw angles by interpolating `comp`, ENCODER_COMP_SIZE entries in ENCODER_COMP_UNIT
+// from angle 0, or NULL to use raw angles
+void encoder_set_comp(struct encoder_state *state, const int16_t *comp)
+{
+	state->comp = comp;
+}
+
+// Track velocity with a critically damped PLL of `bandwidth` rad/s, 0 to use finite difference
+void encoder_set_pll(struct encoder_state *state, float bandwidth)
+{
+	state->pll_kp = 2.0f * bandwidth;
+	state->pll_ki = 0.25f * state->pll_kp * state->pll_kp;
+	state->pll_angle = encoder_get_full_angle(state);
+	state->pll_velocity = 0.0f;
+}
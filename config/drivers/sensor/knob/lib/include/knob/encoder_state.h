@@ -8,6 +8,14 @@
 #include <zephyr/device.h>
 #include <stdint.h>
 
+#include <knob/math.h>
+
+// Entries of the angle correction table, evenly spaced over one revolution
+#define ENCODER_COMP_SIZE 64
+
+// Unit of the angle correction table, in radians
+#define ENCODER_COMP_UNIT (PI2 / 65536.0f)
+
 struct encoder_state {
 	float angle_last;
 	uint32_t angle_time;
@@ -17,6 +25,15 @@ struct encoder_state {
 
 	int32_t rotation_count;
 	int32_t rotation_count_last;
+
+	// Correction added to raw angles, see encoder_set_comp()
+	const int16_t *comp;
+
+	// PLL observer gains and state, finite difference is used while pll_kp is 0
+	float pll_kp;
+	float pll_ki;
+	float pll_angle;
+	float pll_velocity;
 };
 
 void encoder_init(struct encoder_state *state, const struct device *dev);
@@ -24,3 +41,5 @@ void encoder_update(struct encoder_state *state, const struct device *dev);
 float encoder_get_lap_angle(struct encoder_state *state);
 float encoder_get_full_angle(struct encoder_state *state);
 float encoder_get_velocity(struct encoder_state *state);
+void encoder_set_pll(struct encoder_state *state, float bandwidth);
+void encoder_set_comp(struct encoder_state *state, const int16_t *comp);
@@ -11,7 +11,11 @@ struct lpf {
 	uint32_t timestamp;
 	float output_last;
 	float time_constant;
+	// Fixed time step, and the smoothing factor for it, see lpf_set_rate()
+	float dt;
+	float alpha;
 };
 
 void lpf_init(struct lpf *lpf, float time_constant);
+void lpf_set_rate(struct lpf *lpf, float dt);
 float lpf_apply(struct lpf *lpf, float input);
@@ -55,7 +55,7 @@
  */
 static inline float norm_rad(float radian)
 {
-	float r = fmod(radian, PI2);
+	float r = fmodf(radian, PI2);
 	return r >= 0 ? r : (r + PI2);
 }
 
@@ -17,8 +17,14 @@ struct pid {
 	float output_last;
 	float integral_last;
 	uint32_t timestamp;
+	// Fixed time step, and the gains pre-scaled by it, see pid_set_rate()
+	float dt;
+	float i_dt;
+	float d_dt;
+	float ramp_dt;
 };
 
 void pid_init(struct pid *pid, float p, float i, float d, float ramp, float limit);
 void pid_set(struct pid *pid, float p, float i, float d);
+void pid_set_rate(struct pid *pid, float dt);
 float pid_regulate(struct pid *pid, float error);
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <knob/math.h>
+
+#define SVPWM_SIN_TABLE_SIZE      64
+#define SVPWM_SIN_TABLE_FRAC_BITS 10
+
+/**
+ * @brief Radian to Q16 electrical angle, where 65536 is a full turn. Wraps without fmod.
+ */
+static inline uint16_t svpwm_rad_to_q16(float radian)
+{
+	return (uint16_t)(int32_t)(radian * (65536.0f / PI2));
+}
+
+/**
+ * @brief Locate a Q16 electrical angle in the SVPWM hexagon
+ *
+ * @param angle Electrical angle in Q16
+ * @param s1 sin(π/3 - θ) in Q15, where θ is the angle inside the sector
+ * @param s2 sin(θ) in Q15
+ * @return Sector, from 1 to 6
+ */
+uint8_t svpwm_sector_q16(uint16_t angle, uint32_t *s1, uint32_t *s2);
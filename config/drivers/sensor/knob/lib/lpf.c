@@ -11,10 +11,24 @@ void lpf_init(struct lpf *lpf, float time_constant)
 	lpf->time_constant = time_constant;
 	lpf->output_last = 0.0f;
 	lpf->timestamp = time_us();
+	lpf->dt = 0.0f;
+}
+
+// Filter every `dt` seconds instead of measuring the time between calls, 0 to measure again
+void lpf_set_rate(struct lpf *lpf, float dt)
+{
+	lpf->dt = dt;
+	lpf->alpha = lpf->time_constant / (lpf->time_constant + dt);
+	lpf->timestamp = time_us();
 }
 
 float lpf_apply(struct lpf *lpf, float input)
 {
+	if (lpf->dt > 0.0f) {
+		lpf->output_last = input + lpf->alpha * (lpf->output_last - input);
+		return lpf->output_last;
+	}
+
 	uint32_t time = time_us();
 	float dt = ((float)time - (float)lpf->timestamp) * 1e-6f;
 
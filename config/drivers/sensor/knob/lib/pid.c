@@ -7,6 +7,17 @@
 #include <knob/time.h>
 #include <knob/math.h>
 
+static void pid_update_coefficients(struct pid *pid)
+{
+	if (pid->dt <= 0) {
+		return;
+	}
+
+	pid->i_dt = pid->i * pid->dt * 0.5f;
+	pid->d_dt = pid->d / pid->dt;
+	pid->ramp_dt = pid->output_ramp * pid->dt;
+}
+
 void pid_init(struct pid *pid, float p, float i, float d, float ramp, float limit)
 {
 	pid->p = p;
@@ -18,6 +29,7 @@ void pid_init(struct pid *pid, float p, float i, float d, float ramp, float limi
 	pid->output_last = 0;
 	pid->integral_last = 0;
 	pid->timestamp = time_us();
+	pid->dt = 0;
 }
 
 void pid_set(struct pid *pid, float p, float i, float d)
@@ -25,10 +37,47 @@ void pid_set(struct pid *pid, float p, float i, float d)
 	pid->p = p;
 	pid->i = i;
 	pid->d = d;
+	pid_update_coefficients(pid);
+}
+
+// Regulate every `dt` seconds instead of measuring the time between calls, 0 to measure again
+void pid_set_rate(struct pid *pid, float dt)
+{
+	pid->dt = dt;
+	pid->timestamp = time_us();
+	pid_update_coefficients(pid);
+}
+
+static float pid_regulate_fixed(struct pid *pid, float error)
+{
+	float p = pid->p * error;
+
+	float i = pid->integral_last + pid->i_dt * (error + pid->error_last);
+	i = CLAMP(i, -pid->limit, pid->limit);
+
+	float d = pid->d_dt * (error - pid->error_last);
+
+	float output = p + i + d;
+	output = CLAMP(output, -pid->limit, pid->limit);
+
+	if (pid->output_ramp > 0) {
+		output = CLAMP(output, pid->output_last - pid->ramp_dt,
+			       pid->output_last + pid->ramp_dt);
+	}
+
+	pid->integral_last = i;
+	pid->output_last = output;
+	pid->error_last = error;
+
+	return output;
 }
 
 float pid_regulate(struct pid *pid, float error)
 {
+	if (pid->dt > 0) {
+		return pid_regulate_fixed(pid, error);
+	}
+
 	uint32_t time = time_us();
 	float dt = (float)(time - pid->timestamp) * 1e-6f;
 
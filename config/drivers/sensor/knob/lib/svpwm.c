@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <knob/svpwm.h>
+
+/* sin(x) for x in [0, π/3], in Q15 */
+static const uint16_t svpwm_sin_table[SVPWM_SIN_TABLE_SIZE + 1] = {
+	0, 536, 1072, 1608, 2143, 2678, 3212, 3745,
+	4277, 4808, 5338, 5866, 6393, 6918, 7441, 7962,
+	8481, 8998, 9512, 10024, 10533, 11039, 11543, 12043,
+	12540, 13033, 13524, 14010, 14493, 14972, 15447, 15917,
+	16384, 16846, 17304, 17757, 18205, 18648, 19087, 19520,
+	19948, 20371, 20788, 21199, 21605, 22006, 22400, 22788,
+	23170, 23546, 23916, 24279, 24636, 24986, 25330, 25667,
+	25997, 26320, 26635, 26944, 27246, 27540, 27827, 28106,
+	28378,
+};
+
+static inline uint32_t svpwm_sin(uint32_t pos)
+{
+	uint32_t i = pos >> SVPWM_SIN_TABLE_FRAC_BITS;
+	uint32_t frac = pos & ((1U << SVPWM_SIN_TABLE_FRAC_BITS) - 1);
+
+	if (i >= SVPWM_SIN_TABLE_SIZE) {
+		return svpwm_sin_table[SVPWM_SIN_TABLE_SIZE];
+	}
+
+	return svpwm_sin_table[i] +
+	       (((svpwm_sin_table[i + 1] - svpwm_sin_table[i]) * frac) >> SVPWM_SIN_TABLE_FRAC_BITS);
+}
+
+uint8_t svpwm_sector_q16(uint16_t angle, uint32_t *s1, uint32_t *s2)
+{
+	uint32_t x = (uint32_t)angle * 6;
+	uint32_t pos = x & 0xFFFF;
+
+	*s1 = svpwm_sin(0x10000 - pos);
+	*s2 = svpwm_sin(pos);
+
+	return (x >> 16) + 1;
+}
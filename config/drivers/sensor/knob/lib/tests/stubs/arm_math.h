@@ -0,0 +1,15 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <math.h>
+
+// The library under test only needs <math.h>, CMSIS-DSP is left to the firmware. Its fast sine
+// is a table with an error of about 1e-6, the libm one stands in for it.
+static inline float arm_sin_f32(float x)
+{
+	return sinf(x);
+}
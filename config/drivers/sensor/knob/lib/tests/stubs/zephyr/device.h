@@ -0,0 +1,15 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <errno.h>
+
+struct device {
+	const char *name;
+	const void *config;
+	const void *api;
+	void *data;
+};
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifndef CLAMP
+#define CLAMP(val, low, high) (((val) <= (low)) ? (low) : (((val) >= (high)) ? (high) : (val)))
+#endif
+
+// Simulated uptime in microseconds, only moved by the test or by sleeping
+extern int64_t test_uptime_us;
+
+static inline int64_t k_uptime_ticks(void)
+{
+	return test_uptime_us;
+}
+
+static inline uint32_t k_ticks_to_us_floor32(int64_t ticks)
+{
+	return (uint32_t)ticks;
+}
+
+static inline int32_t k_usleep(int32_t us)
+{
+	test_uptime_us += us;
+	return 0;
+}
+
+static inline int32_t k_msleep(int32_t ms)
+{
+	test_uptime_us += (int64_t)ms * 1000;
+	return 0;
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+int64_t test_uptime_us;
+
+static int test_failures;
+
+#define CHECK(cond, fmt, ...)                                                                      \
+	do {                                                                                       \
+		if (!(cond)) {                                                                     \
+			printf("%s:%d: " fmt "\n", __FILE__, __LINE__, ##__VA_ARGS__);             \
+			test_failures++;                                                           \
+		}                                                                                  \
+	} while (0)
+
+#define CHECK_NEAR(a, b, tol)                                                                      \
+	CHECK(fabsf((float)(a) - (float)(b)) <= (tol), "%s = %g, expected %g +/- %g", #a,          \
+	      (double)(a), (double)(b), (double)(tol))
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+// Stability and lag of the discrete PLL velocity observer, at the default `pll-bandwidth` of
+// zmk,motor and the 200us tick of the timer trigger.
+
+#include "test.h"
+
+#include <knob/encoder_state.h>
+#include <knob/drivers/encoder.h>
+
+#define BANDWIDTH 1000.0f
+#define TICK_US 200
+#define TICK_DT (TICK_US * 1e-6f)
+
+// Angle the fake encoder reads, before wrapping and quantization
+static double sim_angle;
+static int sim_bits;
+
+static float sim_get_radian(const struct device *dev)
+{
+	double angle = fmod(sim_angle, 2.0 * M_PI);
+	if (angle < 0) {
+		angle += 2.0 * M_PI;
+	}
+
+	if (sim_bits > 0) {
+		double lsb = 2.0 * M_PI / (1 << sim_bits);
+		angle = floor(angle / lsb) * lsb;
+	}
+
+	return (float)angle;
+}
+
+static const struct encoder_driver_api sim_api = {
+	.get_radian = sim_get_radian,
+};
+
+static const struct device sim_dev = {
+	.name = "sim",
+	.api = &sim_api,
+};
+
+static void sim_start(struct encoder_state *state, int bits)
+{
+	sim_angle = 0;
+	sim_bits = bits;
+
+	encoder_init(state, &sim_dev);
+	encoder_set_pll(state, BANDWIDTH);
+}
+
+static float sim_tick(struct encoder_state *state, double velocity)
+{
+	test_uptime_us += TICK_US;
+	sim_angle += velocity * TICK_DT;
+
+	encoder_update(state, &sim_dev);
+	return encoder_get_velocity(state);
+}
+
+// One step of the observer, with the encoder at rest, maps the angle and velocity errors by
+// [[1 - g, (1 - g) dt], [-ki dt, 1 - ki dt^2]], g = kp dt. Its eigenvalues must be inside the
+// unit circle.
+static void test_pll_spectral_radius(void)
+{
+	struct encoder_state state;
+	sim_start(&state, 0);
+
+	double kp = state.pll_kp, ki = state.pll_ki, dt = TICK_DT;
+	double g = kp * dt;
+	double a = 1 - g, b = (1 - g) * dt, c = -ki * dt, d = 1 - ki * dt * dt;
+
+	double trace = a + d, det = a * d - b * c;
+	double disc = trace * trace / 4 - det;
+	double radius;
+	if (disc >= 0) {
+		radius = fmax(fabs(trace / 2 + sqrt(disc)), fabs(trace / 2 - sqrt(disc)));
+	} else {
+		radius = sqrt(det);
+	}
+
+	printf("spectral radius %.4f at %.0f rad/s, %d us\n", radius, (double)BANDWIDTH, TICK_US);
+	CHECK(radius < 0.95, "spectral radius %g too close to instability", radius);
+}
+
+static void test_pll_velocity_step(void)
+{
+	struct encoder_state state;
+	sim_start(&state, 0);
+
+	const double velocity = 20.0;
+	int settled = -1;
+	float peak = 0;
+
+	for (int n = 0; n < 500; n++) {
+		float v = sim_tick(&state, velocity);
+		peak = fmaxf(peak, v);
+		if (settled < 0 && fabs(v - velocity) < 0.02 * velocity) {
+			settled = n;
+		} else if (fabs(v - velocity) >= 0.02 * velocity) {
+			settled = -1;
+		}
+	}
+
+	printf("step settles within 2%% in %d us, overshoot %.1f%%\n", settled * TICK_US,
+	       (peak / velocity - 1) * 100);
+	CHECK(settled >= 0 && settled * TICK_US <= 10000, "step settled after %d ticks", settled);
+	CHECK(peak < 1.2 * velocity, "step overshoot to %g", (double)peak);
+}
+
+// Under a constant acceleration the phase error settles at accel / ki, which leaves the velocity
+// kp / ki = 2 / bandwidth seconds behind
+static void test_pll_velocity_ramp(void)
+{
+	struct encoder_state state;
+	sim_start(&state, 0);
+
+	const double accel = 500.0;
+	double velocity = 0;
+	float error = 0;
+
+	for (int n = 0; n < 500; n++) {
+		velocity += accel * TICK_DT;
+		// Velocity at the middle of the tick, as the angle integrates it over the tick
+		error = sim_tick(&state, velocity) - (velocity - accel * TICK_DT / 2);
+	}
+
+	float lag = -error / accel;
+	printf("ramp lags by %.1f us\n", lag * 1e6);
+	CHECK(lag > 0 && lag <= 2.0f / BANDWIDTH, "ramp lag %g s", (double)lag);
+}
+
+// Across the wrap of the 14-bit AS5047P, the PLL must be quieter than finite difference
+static void test_pll_quantized(void)
+{
+	struct encoder_state pll, diff;
+	const double velocity = 3.0;
+
+	sim_start(&pll, 14);
+	encoder_init(&diff, &sim_dev);
+	sim_angle = 0;
+
+	double pll_sq = 0, diff_sq = 0, pll_sum = 0;
+	int count = 0;
+
+	for (int n = 0; n < 20000; n++) {
+		test_uptime_us += TICK_US;
+		sim_angle += velocity * TICK_DT;
+		encoder_update(&pll, &sim_dev);
+		encoder_update(&diff, &sim_dev);
+		float v_pll = encoder_get_velocity(&pll);
+		float v_diff = encoder_get_velocity(&diff);
+
+		if (n < 100) {
+			continue;
+		}
+
+		pll_sq += (v_pll - velocity) * (v_pll - velocity);
+		diff_sq += (v_diff - velocity) * (v_diff - velocity);
+		pll_sum += v_pll;
+		count++;
+	}
+
+	double pll_rms = sqrt(pll_sq / count), diff_rms = sqrt(diff_sq / count);
+	printf("quantized noise %.3f rad/s rms, %.3f rad/s by difference\n", pll_rms, diff_rms);
+	CHECK_NEAR(pll_sum / count, velocity, 0.01);
+	CHECK(pll_rms < diff_rms / 2, "pll noise %g not below difference %g", pll_rms, diff_rms);
+}
+
+int main(void)
+{
+	test_pll_spectral_radius();
+	test_pll_velocity_step();
+	test_pll_velocity_ramp();
+	test_pll_quantized();
+
+	if (test_failures) {
+		printf("%d check(s) failed\n", test_failures);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+// The fixed-step filter and regulator must follow the time-based ones they replace, given the
+// same time between calls.
+
+#include "test.h"
+
+#include <knob/lpf.h>
+#include <knob/pid.h>
+
+static const uint32_t steps_us[] = {100, 200, 1000};
+
+static void test_lpf_step(uint32_t step_us)
+{
+	struct lpf timed, fixed;
+	float dt = step_us * 1e-6f;
+
+	lpf_init(&timed, 0.005f);
+	lpf_init(&fixed, 0.005f);
+	lpf_set_rate(&fixed, dt);
+
+	for (int n = 0; n < 200000 / step_us; n++) {
+		test_uptime_us += step_us;
+		float a = lpf_apply(&timed, 1.0f);
+		float b = lpf_apply(&fixed, 1.0f);
+		CHECK_NEAR(b, a, 1e-4f);
+	}
+
+	CHECK_NEAR(fixed.output_last, 1.0f, 1e-4f);
+}
+
+// Close the loop over a first-order plant, so that the integral, derivative, limit and ramp
+// all get exercised by the step
+static void test_pid_step(uint32_t step_us, float p, float i, float d, float ramp, float limit)
+{
+	struct pid timed, fixed;
+	float y_timed = 0, y_fixed = 0;
+	float dt = step_us * 1e-6f;
+	const float tau = 0.02f;
+
+	pid_init(&timed, p, i, d, ramp, limit);
+	pid_init(&fixed, p, i, d, ramp, limit);
+	pid_set_rate(&fixed, dt);
+
+	for (int n = 0; n < 500000 / step_us; n++) {
+		test_uptime_us += step_us;
+		float u_timed = pid_regulate(&timed, 1.0f - y_timed);
+		float u_fixed = pid_regulate(&fixed, 1.0f - y_fixed);
+		CHECK_NEAR(u_fixed, u_timed, 1e-4f * (1.0f + fabsf(u_timed)));
+		if (fabsf(u_fixed - u_timed) > 1e-4f * (1.0f + fabsf(u_timed))) {
+			return;
+		}
+
+		y_timed += (u_timed - y_timed) * dt / tau;
+		y_fixed += (u_fixed - y_fixed) * dt / tau;
+	}
+
+	CHECK_NEAR(y_fixed, y_timed, 1e-3f);
+}
+
+static void test_pid_set_keeps_rate(void)
+{
+	struct pid timed, fixed;
+
+	pid_init(&timed, 1.0f, 10.0f, 0.0f, 0.0f, 5.0f);
+	pid_init(&fixed, 1.0f, 10.0f, 0.0f, 0.0f, 5.0f);
+	pid_set_rate(&fixed, 200e-6f);
+
+	pid_set(&timed, 2.0f, 20.0f, 0.001f);
+	pid_set(&fixed, 2.0f, 20.0f, 0.001f);
+
+	for (int n = 0; n < 100; n++) {
+		test_uptime_us += 200;
+		float a = pid_regulate(&timed, 0.5f);
+		float b = pid_regulate(&fixed, 0.5f);
+		CHECK_NEAR(b, a, 1e-4f * (1.0f + fabsf(a)));
+	}
+}
+
+int main(void)
+{
+	for (size_t n = 0; n < sizeof(steps_us) / sizeof(steps_us[0]); n++) {
+		uint32_t step_us = steps_us[n];
+
+		test_lpf_step(step_us);
+		// Proportional-integral, as the velocity loop is configured
+		test_pid_step(step_us, 0.5f, 20.0f, 0.0f, 0.0f, 3.0f);
+		// Derivative with a saturated output
+		test_pid_step(step_us, 3.0f, 5.0f, 0.002f, 0.0f, 1.5f);
+		// Ramp-limited output
+		test_pid_step(step_us, 2.0f, 10.0f, 0.0f, 50.0f, 5.0f);
+	}
+
+	test_pid_set_keeps_rate();
+
+	if (test_failures) {
+		printf("%d check(s) failed\n", test_failures);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2023 XiNGRZ
+ * SPDX-License-Identifier: MIT
+ */
+
+// The table-based sector lookup behind KNOB_MOTOR_SVPWM_LUT must give the same sector and
+// t1/t2 as the floorf/arm_sin_f32 path of motor_set_phase_voltage(), for every Q16 angle.
+
+#include "test.h"
+
+#include <stdbool.h>
+#include <time.h>
+
+#include <knob/math.h>
+#include <knob/svpwm.h>
+
+// Error of t1/t2 at full modulation, for a duty cycle of 0 to 1: the truncation to a Q16 step
+// (9.6e-5 rad, times √3) plus the interpolation and Q15 rounding of the table
+#define T_TOLERANCE 3e-4f
+
+// Turns the angle is wrapped by, to check that negative and large radians convert as well
+static const int turns[] = {0, -1, -3, 2};
+#define N_TURNS (sizeof(turns) / sizeof(turns[0]))
+
+struct sector {
+	uint8_t sec;
+	float t1;
+	float t2;
+};
+
+static void sector_float(float angle, struct sector *out)
+{
+	angle = norm_rad(angle);
+
+	out->sec = (int)(floorf(angle / PI_3)) + 1;
+	out->t1 = SQRT3 * arm_sin_f32((float)out->sec * PI_3 - angle);
+	out->t2 = SQRT3 * arm_sin_f32(angle - ((float)out->sec - 1.0f) * PI_3);
+}
+
+static void sector_lut(float angle, struct sector *out)
+{
+	uint32_t s1, s2;
+
+	out->sec = svpwm_sector_q16(svpwm_rad_to_q16(angle), &s1, &s2);
+	out->t1 = (float)s1 * (SQRT3 / 32768.0f);
+	out->t2 = (float)s2 * (SQRT3 / 32768.0f);
+}
+
+// Across a sector boundary, (sec, t1 = 0, t2) and (sec + 1, t1 = t2', t2 = 0) are the same
+// vector, compare in the sector of the reference
+static void align(const struct sector *ref, struct sector *lut)
+{
+	if (lut->sec == ref->sec % 6 + 1) {
+		lut->sec = ref->sec;
+		lut->t2 = lut->t1;
+		lut->t1 = 0.0f;
+	} else if (ref->sec == lut->sec % 6 + 1) {
+		lut->sec = ref->sec;
+		lut->t1 = lut->t2;
+		lut->t2 = 0.0f;
+	}
+}
+
+static void test_svpwm_accuracy(void)
+{
+	float max_error = 0.0f;
+	int boundary = 0;
+
+	for (size_t t = 0; t < N_TURNS; t++) {
+		for (uint32_t q = 0; q < 65536; q++) {
+			float angle = (float)q * (PI2 / 65536.0f) + (float)turns[t] * PI2;
+			struct sector ref, lut;
+
+			sector_float(angle, &ref);
+			sector_lut(angle, &lut);
+
+			if (lut.sec != ref.sec) {
+				align(&ref, &lut);
+				boundary++;
+			}
+
+			if (lut.sec != ref.sec) {
+				CHECK(false, "angle %d + %d turns: sector %d, expected %d", q, turns[t],
+				      lut.sec, ref.sec);
+				continue;
+			}
+
+			max_error = fmaxf(max_error, fabsf(lut.t1 - ref.t1));
+			max_error = fmaxf(max_error, fabsf(lut.t2 - ref.t2));
+		}
+	}
+
+	printf("max t1/t2 error %.2e, %d angles on a sector boundary\n", (double)max_error,
+	       boundary);
+	CHECK(max_error <= T_TOLERANCE, "t1/t2 error %g", (double)max_error);
+	// Only a float rounding right at the boundary may pick the neighbour sector
+	CHECK(boundary <= 6 * (int)N_TURNS * 2, "%d angles in another sector", boundary);
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void test_svpwm_timing(void)
+{
+	volatile float sink = 0.0f;
+	struct sector out;
+	const int rounds = 16;
+
+	double start = now_ns();
+	for (int r = 0; r < rounds; r++) {
+		for (uint32_t q = 0; q < 65536; q++) {
+			sector_float((float)q * (PI2 / 65536.0f), &out);
+			sink += out.t1 + out.t2;
+		}
+	}
+	double ns_float = (now_ns() - start) / (rounds * 65536.0);
+
+	start = now_ns();
+	for (int r = 0; r < rounds; r++) {
+		for (uint32_t q = 0; q < 65536; q++) {
+			sector_lut((float)q * (PI2 / 65536.0f), &out);
+			sink += out.t1 + out.t2;
+		}
+	}
+	double ns_lut = (now_ns() - start) / (rounds * 65536.0);
+
+	// On the host, sinf() stands in for arm_sin_f32(), which is cheaper than libm on the MCU
+	printf("per angle: float %.1f ns, table %.1f ns (%.1fx)\n", ns_float, ns_lut,
+	       ns_float / ns_lut);
+}
+
+int main(void)
+{
+	test_svpwm_accuracy();
+	test_svpwm_timing();
+
+	if (test_failures) {
+		printf("%d check(s) failed\n", test_failures);
+		return 1;
+	}
+
+	return 0;
+}
@@ -7,11 +7,14 @@
 
 #include <zephyr/device.h>
 #include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <string.h>
 
 #include <knob/time.h>
 #include <knob/math.h>
 #include <knob/lpf.h>
 #include <knob/pid.h>
+#include <knob/svpwm.h>
 #include <knob/encoder_state.h>
 #include <knob/drivers/inverter.h>
 #include <knob/drivers/motor.h>
@@ -21,6 +24,21 @@ LOG_MODULE_REGISTER(motor, CONFIG_ZMK_LOG_LEVEL);
 
 #define MOTOR_VOLTAGE (12.0f)
 
+#ifdef CONFIG_KNOB_MOTOR_TRACE
+BUILD_ASSERT((CONFIG_KNOB_MOTOR_TRACE_SIZE & (CONFIG_KNOB_MOTOR_TRACE_SIZE - 1)) == 0,
+	     "CONFIG_KNOB_MOTOR_TRACE_SIZE must be a power of 2");
+
+struct motor_trace {
+	struct motor_state states[CONFIG_KNOB_MOTOR_TRACE_SIZE];
+	atomic_t head;
+	atomic_t tail;
+	atomic_t dropped;
+	uint32_t decimation;
+	uint32_t counter;
+	bool enable;
+};
+#endif /* CONFIG_KNOB_MOTOR_TRACE */
+
 struct motor_data {
 	float voltage_limit;
 	float velocity_limit;
@@ -34,43 +52,65 @@ struct motor_data {
 	struct pid pid_velocity;
 	struct pid pid_angle;
 
-	float raw_angle;
-	float est_angle;
-	float raw_velocity;
-	float est_velocity;
+	struct motor_sample sample;
 
 	struct encoder_state encoder_state;
 	enum motor_direction direction;
 
 	float zero_offset;
 
+#ifdef CONFIG_KNOB_MOTOR_ENCODER_COMP
+	int16_t encoder_comp[ENCODER_COMP_SIZE];
+	bool encoder_comp_valid;
+#endif /* CONFIG_KNOB_MOTOR_ENCODER_COMP */
+
+#ifdef CONFIG_KNOB_MOTOR_ANTICOGGING
+	int16_t anticogging[MOTOR_ANTICOGGING_SIZE];
+	bool anticogging_valid;
+	// Held by a tick, and by motor_calibrate_anticogging() while it drives the motor
+	struct k_mutex lock;
+	atomic_t busy;
+#endif /* CONFIG_KNOB_MOTOR_ANTICOGGING */
+
 	bool enable;
 
+	// Period of the timer trigger in seconds, or 0 if ticks are not paced by the timer
+	float tick_dt;
+	// Fixed time step the filters and regulators currently run at, only changed by the tick
+	float rate_dt;
+
 	float set_point_voltage;
 	float set_point_velocity;
 	float set_point_angle;
+
+#ifdef CONFIG_KNOB_MOTOR_TRACE
+	struct motor_trace trace;
+#endif /* CONFIG_KNOB_MOTOR_TRACE */
 };
 
 struct motor_config {
 	const struct device *inverter;
 	const struct device *encoder;
 	int pole_pairs;
+	int pll_bandwidth;
 };
 
+static void motor_update_sample(const struct device *dev);
 static void motor_close_loop_control_tick(const struct device *dev);
 static void motor_foc_output_tick(const struct device *dev);
 static void motor_set_phase_voltage(const struct device *dev, float v_q, float v_d, float angle);
+#ifdef CONFIG_KNOB_MOTOR_TRACE
+static void motor_trace_record(const struct device *dev);
+#endif /* CONFIG_KNOB_MOTOR_TRACE */
 
 int motor_calibrate_set(const struct device *dev, float zero_offset, enum motor_direction direction)
 {
 	struct motor_data *data = dev->data;
-	const struct motor_config *config = dev->config;
 
 	data->zero_offset = zero_offset;
 	data->direction = direction;
 
-	encoder_update(&data->encoder_state, config->encoder);
-	motor_get_estimate_angle(dev);
+	motor_update_sample(dev);
 
 	return 0;
 }
@@ -84,6 +124,137 @@ int motor_calibrate_get(const struct device *dev, float *zero_offset,
 	return 0;
 }
 
+#ifdef CONFIG_KNOB_MOTOR_ENCODER_COMP
+BUILD_ASSERT(MOTOR_ENCODER_COMP_SIZE == ENCODER_COMP_SIZE, "Encoder table size mismatch");
+
+// Steps of the open loop sweep per electrical cycle
+#define ENCODER_COMP_STEPS 64
+
+static int motor_calibrate_encoder(const struct device *dev)
+{
+	struct motor_data *data = dev->data;
+	const struct motor_config *config = dev->config;
+
+	static float sums[ENCODER_COMP_SIZE];
+	static uint16_t counts[ENCODER_COMP_SIZE];
+	const int steps = config->pole_pairs * ENCODER_COMP_STEPS;
+
+	memset(sums, 0, sizeof(sums));
+	memset(counts, 0, sizeof(counts));
+
+	LOG_DBG("Capture encoder nonlinearity");
+
+	encoder_set_comp(&data->encoder_state, NULL);
+
+	motor_set_phase_voltage(dev, data->voltage_limit_calib, 0.0f, PI3_2);
+	k_msleep(500);
+
+	encoder_update(&data->encoder_state, config->encoder);
+	float start = encoder_get_lap_angle(&data->encoder_state);
+
+	// Sweep a full revolution forth and back, so that the lag of the rotor cancels out
+	for (int pass = 0; pass < 2; pass++) {
+		for (int s = 0; s <= steps; s++) {
+			int k = pass == 0 ? s : steps - s;
+
+			motor_set_phase_voltage(dev, data->voltage_limit_calib, 0.0f,
+						PI3_2 + PI2 * (float)k / ENCODER_COMP_STEPS);
+			k_msleep(2);
+
+			encoder_update(&data->encoder_state, config->encoder);
+			float measured = encoder_get_lap_angle(&data->encoder_state);
+			float expected = start + (float)data->direction * PI2 * (float)k / steps;
+			float error = norm_rad(expected - measured + PI) - PI;
+
+			int bin = (int)(measured * (ENCODER_COMP_SIZE / PI2) + 0.5f) &
+				  (ENCODER_COMP_SIZE - 1);
+			sums[bin] += error;
+			counts[bin]++;
+		}
+	}
+
+	float mean = 0.0f;
+	int filled = 0;
+	for (int i = 0; i < ENCODER_COMP_SIZE; i++) {
+		if (counts[i]) {
+			sums[i] /= counts[i];
+			mean += sums[i];
+			filled++;
+		}
+	}
+
+	if (filled < ENCODER_COMP_SIZE / 2) {
+		LOG_ERR("Encoder sweep only covered %d of %d bins", filled, ENCODER_COMP_SIZE);
+		return -EIO;
+	}
+
+	// The mean error is a constant offset, which is left to zero_offset
+	mean /= filled;
+
+	float last = 0.0f;
+	for (int i = 0; i < ENCODER_COMP_SIZE * 2; i++) {
+		int bin = i % ENCODER_COMP_SIZE;
+		if (counts[bin]) {
+			last = sums[bin] - mean;
+		}
+		// Bins not hit take the one before, the second lap fills those before the first hit
+		data->encoder_comp[bin] = (int16_t)roundf(last / ENCODER_COMP_UNIT);
+		if (counts[bin] && i >= ENCODER_COMP_SIZE) {
+			break;
+		}
+	}
+
+	data->encoder_comp_valid = true;
+	encoder_set_comp(&data->encoder_state, data->encoder_comp);
+
+	LOG_INF("Captured encoder nonlinearity, mean error %f deg", rad_to_deg(mean));
+
+	return 0;
+}
+
+int motor_encoder_comp_get(const struct device *dev, int16_t *comp)
+{
+	struct motor_data *data = dev->data;
+
+	if (!data->encoder_comp_valid) {
+		return -ENODATA;
+	}
+
+	memcpy(comp, data->encoder_comp, sizeof(data->encoder_comp));
+	return 0;
+}
+
+int motor_encoder_comp_set(const struct device *dev, const int16_t *comp)
+{
+	struct motor_data *data = dev->data;
+
+	if (comp == NULL) {
+		data->encoder_comp_valid = false;
+		encoder_set_comp(&data->encoder_state, NULL);
+		return 0;
+	}
+
+	memcpy(data->encoder_comp, comp, sizeof(data->encoder_comp));
+	data->encoder_comp_valid = true;
+	encoder_set_comp(&data->encoder_state, data->encoder_comp);
+	return 0;
+}
+#else
+int motor_encoder_comp_get(const struct device *dev, int16_t *comp)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(comp);
+	return -ENOTSUP;
+}
+
+int motor_encoder_comp_set(const struct device *dev, const int16_t *comp)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(comp);
+	return -ENOTSUP;
+}
+#endif /* CONFIG_KNOB_MOTOR_ENCODER_COMP */
+
 int motor_calibrate_auto(const struct device *dev)
 {
 	struct motor_data *data = dev->data;
@@ -135,6 +306,12 @@ int motor_calibrate_auto(const struct device *dev)
 
 	LOG_INF("Detected encoder direction: %d", data->direction);
 
+#ifdef CONFIG_KNOB_MOTOR_ENCODER_COMP
+	if (!data->encoder_comp_valid && motor_calibrate_encoder(dev) != 0) {
+		LOG_WRN("Encoder nonlinearity not compensated");
+	}
+#endif /* CONFIG_KNOB_MOTOR_ENCODER_COMP */
+
 	motor_set_phase_voltage(dev, data->voltage_limit_calib, 0.0f, PI3_2);
 
 	k_msleep(1000);
@@ -147,30 +324,345 @@ int motor_calibrate_auto(const struct device *dev)
 	inverter_stop(config->inverter);
 	LOG_INF("Calibration finished");
 
+	motor_update_sample(dev);
+
+	return 0;
+}
+
+// Max electrical angle between the rotor and the stored zero offset to pass the verification
+#define VERIFY_TOLERANCE 0.5f
+#define VERIFY_SETTLE_MS 40
+
+int motor_calibrate_verify(const struct device *dev)
+{
+	struct motor_data *data = dev->data;
+	const struct motor_config *config = dev->config;
+
+	if (data->direction == UNKNOWN) {
+		return -EINVAL;
+	}
+
+	inverter_start(config->inverter);
+
+	// Where the zero offset was measured, the electrical angle must read 0
+	motor_set_phase_voltage(dev, data->voltage_limit_calib, 0.0f, PI3_2);
+	k_msleep(VERIFY_SETTLE_MS);
+
 	encoder_update(&data->encoder_state, config->encoder);
-	motor_get_estimate_angle(dev);
+	float error = norm_rad(motor_get_electrical_angle(dev) + PI) - PI;
+	float start = encoder_get_lap_angle(&data->encoder_state);
+
+	// A quarter electrical cycle forward must move the encoder in the stored direction
+	motor_set_phase_voltage(dev, data->voltage_limit_calib, 0.0f, PI3_2 + PI_2);
+	k_msleep(VERIFY_SETTLE_MS);
+
+	encoder_update(&data->encoder_state, config->encoder);
+	float delta = norm_rad(encoder_get_lap_angle(&data->encoder_state) - start + PI) - PI;
+
+	motor_set_phase_voltage(dev, 0.0f, 0.0f, 0.0f);
+	inverter_stop(config->inverter);
+
+	motor_update_sample(dev);
+
+	LOG_DBG("Verify calibration, error: %f deg, delta: %f deg", rad_to_deg(error),
+		rad_to_deg(delta));
+
+	if (fabsf(error) > VERIFY_TOLERANCE || delta * (float)data->direction <= 0.0f) {
+		return -EIO;
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_KNOB_MOTOR_ANTICOGGING
+BUILD_ASSERT((MOTOR_ANTICOGGING_SIZE & (MOTOR_ANTICOGGING_SIZE - 1)) == 0,
+	     "MOTOR_ANTICOGGING_SIZE must be a power of 2");
+
+// Gains of the position loop holding the rotor, from rad to V
+#define ANTICOGGING_P 20.0f
+#define ANTICOGGING_I 1000.0f
+#define ANTICOGGING_D 0.05f
+
+#define ANTICOGGING_SETTLE_MS  20
+#define ANTICOGGING_MEASURE_MS 10
+#define ANTICOGGING_TOLERANCE  (PI2 / MOTOR_ANTICOGGING_SIZE * 4.0f)
+
+// Holds the rotor at `target` for `ms` with a 1 ms loop, and returns the mean output over the
+// last ANTICOGGING_MEASURE_MS, when the integral carries the voltage against cogging
+static float motor_anticogging_hold(const struct device *dev, struct pid *hold, float target,
+				    int ms)
+{
+	struct motor_data *data = dev->data;
+	float sum = 0.0f;
+
+	for (int i = 0; i < ms; i++) {
+		motor_update_sample(dev);
+
+		float voltage = pid_regulate(hold, target - data->sample.raw_angle);
+		motor_set_phase_voltage(dev, voltage * data->direction, 0.0f,
+					data->sample.electrical_angle * data->direction);
+
+		if (i >= ms - ANTICOGGING_MEASURE_MS) {
+			sum += voltage;
+		}
+
+		k_msleep(1);
+	}
+
+	return sum / ANTICOGGING_MEASURE_MS;
+}
+
+int motor_calibrate_anticogging(const struct device *dev)
+{
+	struct motor_data *data = dev->data;
+	const struct motor_config *config = dev->config;
+
+	static float sums[MOTOR_ANTICOGGING_SIZE];
+	static uint8_t counts[MOTOR_ANTICOGGING_SIZE];
+	struct pid hold;
+	int ret = 0;
+
+	if (data->direction == UNKNOWN) {
+		return -EINVAL;
+	}
+
+	memset(sums, 0, sizeof(sums));
+	memset(counts, 0, sizeof(counts));
+
+	LOG_INF("Anti-cogging calibration start");
+
+	// Waits for a tick in progress, later ones skip until the lock is released
+	k_mutex_lock(&data->lock, K_FOREVER);
+	atomic_set(&data->busy, 1);
+
+	inverter_start(config->inverter);
+	pid_init(&hold, ANTICOGGING_P, ANTICOGGING_I, ANTICOGGING_D, 0.0f,
+		 data->voltage_limit_calib);
+
+	motor_update_sample(dev);
+	float start = data->sample.raw_angle;
+	motor_anticogging_hold(dev, &hold, start, 200);
+
+	// Step a full revolution forth and back, so that friction cancels out
+	for (int pass = 0; pass < 2 && ret == 0; pass++) {
+		for (int s = 0; s < MOTOR_ANTICOGGING_SIZE; s++) {
+			int k = pass == 0 ? s : MOTOR_ANTICOGGING_SIZE - s;
+			float target = start + PI2 * (float)k / MOTOR_ANTICOGGING_SIZE;
+			float voltage = motor_anticogging_hold(
+				dev, &hold, target, ANTICOGGING_SETTLE_MS + ANTICOGGING_MEASURE_MS);
+
+			if (fabsf(target - data->sample.raw_angle) > ANTICOGGING_TOLERANCE) {
+				LOG_ERR("Rotor did not follow, at %f deg for %f deg",
+					rad_to_deg(data->sample.raw_angle), rad_to_deg(target));
+				ret = -EIO;
+				break;
+			}
+
+			int bin = (int)(encoder_get_lap_angle(&data->encoder_state) *
+					(MOTOR_ANTICOGGING_SIZE / PI2) +
+					0.5f) &
+				  (MOTOR_ANTICOGGING_SIZE - 1);
+			sums[bin] += voltage;
+			counts[bin]++;
+		}
+	}
+
+	motor_set_phase_voltage(dev, 0.0f, 0.0f, 0.0f);
+
+	// motor_set_enable() only recorded the state meanwhile. Clearing `busy` first, a call
+	// racing with this either stores `enable` before it is read, or waits for the lock.
+	atomic_clear(&data->busy);
+	if (!data->enable) {
+		inverter_stop(config->inverter);
+	}
+
+	k_mutex_unlock(&data->lock);
+
+	if (ret != 0) {
+		return ret;
+	}
+
+	float mean = 0.0f;
+	int filled = 0;
+	for (int i = 0; i < MOTOR_ANTICOGGING_SIZE; i++) {
+		if (counts[i]) {
+			sums[i] /= counts[i];
+			mean += sums[i];
+			filled++;
+		}
+	}
+
+	// What is left after averaging over a revolution is not cogging, but a load on the knob
+	mean /= filled;
+
+	float last = 0.0f;
+	for (int i = 0; i < MOTOR_ANTICOGGING_SIZE * 2; i++) {
+		int bin = i % MOTOR_ANTICOGGING_SIZE;
+		if (counts[bin]) {
+			last = sums[bin] - mean;
+		}
+		// Bins not hit take the one before, the second lap fills those before the first hit
+		data->anticogging[bin] = (int16_t)roundf(last * 1000.0f);
+		if (counts[bin] && i >= MOTOR_ANTICOGGING_SIZE) {
+			break;
+		}
+	}
+
+	data->anticogging_valid = true;
+
+	LOG_INF("Anti-cogging calibration finished, %d of %d positions, mean %f V", filled,
+		MOTOR_ANTICOGGING_SIZE, mean);
+
+	return 0;
+}
+
+int motor_anticogging_get(const struct device *dev, int16_t *table)
+{
+	struct motor_data *data = dev->data;
+
+	if (!data->anticogging_valid) {
+		return -ENODATA;
+	}
+
+	memcpy(table, data->anticogging, sizeof(data->anticogging));
+	return 0;
+}
 
+int motor_anticogging_set(const struct device *dev, const int16_t *table)
+{
+	struct motor_data *data = dev->data;
+
+	if (table == NULL) {
+		data->anticogging_valid = false;
+		return 0;
+	}
+
+	memcpy(data->anticogging, table, sizeof(data->anticogging));
+	data->anticogging_valid = true;
 	return 0;
 }
 
+static inline float motor_anticogging_lookup(struct motor_data *data)
+{
+	float pos =
+		encoder_get_lap_angle(&data->encoder_state) * (MOTOR_ANTICOGGING_SIZE / PI2);
+	int i = (int)pos;
+	float a = data->anticogging[i & (MOTOR_ANTICOGGING_SIZE - 1)];
+	float b = data->anticogging[(i + 1) & (MOTOR_ANTICOGGING_SIZE - 1)];
+
+	return (a + (b - a) * (pos - (float)i)) * 1e-3f;
+}
+#else
+int motor_calibrate_anticogging(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+	return -ENOTSUP;
+}
+
+int motor_anticogging_get(const struct device *dev, int16_t *table)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(table);
+	return -ENOTSUP;
+}
+
+int motor_anticogging_set(const struct device *dev, const int16_t *table)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(table);
+	return -ENOTSUP;
+}
+#endif /* CONFIG_KNOB_MOTOR_ANTICOGGING */
+
 bool motor_is_calibrated(const struct device *dev)
 {
 	struct motor_data *data = dev->data;
 	return data->direction != UNKNOWN;
 }
 
+// Coefficients are only rewritten here, so that they never change under a running regulator
+static void motor_update_rate(const struct device *dev)
+{
+	struct motor_data *data = dev->data;
+
+	// The timer only paces ticks while the inverter runs, measure the time between them else
+	float dt = data->enable ? data->tick_dt : 0.0f;
+	if (dt == data->rate_dt) {
+		return;
+	}
+
+	lpf_set_rate(&data->lpf_velocity, dt);
+	lpf_set_rate(&data->lpf_angle, dt);
+	pid_set_rate(&data->pid_velocity, dt);
+	pid_set_rate(&data->pid_angle, dt);
+	data->rate_dt = dt;
+}
+
+#ifdef CONFIG_KNOB_MOTOR_ANTICOGGING
+// Takes the lock once a tick in progress is done, but gives up while the calibration holds it
+static bool motor_lock_idle(struct motor_data *data)
+{
+	while (k_mutex_lock(&data->lock, K_MSEC(1)) != 0) {
+		if (atomic_get(&data->busy)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+#endif /* CONFIG_KNOB_MOTOR_ANTICOGGING */
+
 void motor_tick(const struct device *dev)
 {
+#ifdef CONFIG_KNOB_MOTOR_ANTICOGGING
+	struct motor_data *data = dev->data;
+
+	if (k_mutex_lock(&data->lock, K_NO_WAIT) != 0) {
+		return;
+	}
+#endif /* CONFIG_KNOB_MOTOR_ANTICOGGING */
+
+	motor_update_rate(dev);
+	motor_update_sample(dev);
 	motor_close_loop_control_tick(dev);
 	motor_foc_output_tick(dev);
+#ifdef CONFIG_KNOB_MOTOR_TRACE
+	motor_trace_record(dev);
+#endif /* CONFIG_KNOB_MOTOR_TRACE */
+
+#ifdef CONFIG_KNOB_MOTOR_ANTICOGGING
+	k_mutex_unlock(&data->lock);
+#endif /* CONFIG_KNOB_MOTOR_ANTICOGGING */
+}
+
+static void motor_update_sample(const struct device *dev)
+{
+	struct motor_data *data = dev->data;
+	const struct motor_config *config = dev->config;
+	struct motor_sample *sample = &data->sample;
+
+	// The only encoder read in a tick, everything else works on this snapshot
+	encoder_update(&data->encoder_state, config->encoder);
+
+	sample->timestamp = data->encoder_state.angle_time;
+	sample->raw_angle = encoder_get_full_angle(&data->encoder_state);
+	sample->raw_velocity = encoder_get_velocity(&data->encoder_state);
+	sample->angle = lpf_apply(&data->lpf_angle, sample->raw_angle);
+	if (config->pll_bandwidth > 0) {
+		// The observer output is smooth already, filtering it again only adds lag
+		sample->velocity = sample->raw_velocity;
+	} else {
+		sample->velocity = lpf_apply(&data->lpf_velocity, sample->raw_velocity);
+	}
+	sample->electrical_angle = motor_get_electrical_angle(dev);
 }
 
 static void motor_close_loop_control_tick(const struct device *dev)
 {
 	struct motor_data *data = dev->data;
 
-	float estimate_angle = motor_get_estimate_angle(dev);
-	float estimate_velocity = motor_get_estimate_velocity(dev);
+	float estimate_angle = data->sample.angle;
+	float estimate_velocity = data->sample.velocity;
 
 	if (!data->enable)
 		return;
@@ -192,19 +684,23 @@ static void motor_close_loop_control_tick(const struct device *dev)
 			&data->pid_velocity, data->set_point_velocity - estimate_velocity);
 		break;
 	}
+
+#ifdef CONFIG_KNOB_MOTOR_ANTICOGGING
+	// Cancels the cogging torque of the motor itself, so it is not bound by the torque limit
+	if (data->anticogging_valid) {
+		data->set_point_voltage += motor_anticogging_lookup(data);
+	}
+#endif /* CONFIG_KNOB_MOTOR_ANTICOGGING */
 }
 
 static void motor_foc_output_tick(const struct device *dev)
 {
 	struct motor_data *data = dev->data;
-	const struct motor_config *config = dev->config;
-
-	encoder_update(&data->encoder_state, config->encoder);
 
 	if (!data->enable)
 		return;
 
-	float electrical_angle = motor_get_electrical_angle(dev) * data->direction;
+	float electrical_angle = data->sample.electrical_angle * data->direction;
 
 	float voltage_q = data->set_point_voltage * data->direction;
 	float voltage_d = 0.0f;
@@ -220,18 +716,30 @@ static void motor_set_phase_voltage(const struct device *dev, float v_q, float v
 
 	if (v_d != 0) {
 		arm_sqrt_f32(v_d * v_d + v_q * v_q, &mod);
-		angle = norm_rad(angle + atan2f(v_q, v_d));
+		angle = angle + atan2f(v_q, v_d);
 	} else {
 		mod = v_q;
-		angle = norm_rad(angle + PI_2);
+		angle = angle + PI_2;
 	}
 
 	mod = mod / MOTOR_VOLTAGE;
 
+#ifdef CONFIG_KNOB_MOTOR_SVPWM_LUT
+	uint32_t s1, s2;
+	uint8_t sec = svpwm_sector_q16(svpwm_rad_to_q16(angle), &s1, &s2);
+
+	float k = SQRT3 * mod / 32768.0f;
+	float t1 = (float)s1 * k;
+	float t2 = (float)s2 * k;
+#else
+	angle = norm_rad(angle);
+
 	uint8_t sec = (int)(floorf(angle / PI_3)) + 1;
 
 	float t1 = SQRT3 * arm_sin_f32((float)sec * PI_3 - angle) * mod;
 	float t2 = SQRT3 * arm_sin_f32(angle - ((float)sec - 1.0f) * PI_3) * mod;
+#endif /* CONFIG_KNOB_MOTOR_SVPWM_LUT */
+
 	float t0 = 1 - t1 - t2;
 
 	float tA, tB, tC;
@@ -281,11 +789,23 @@ void motor_set_enable(const struct device *dev, bool enable)
 	const struct motor_config *config = dev->config;
 
 	data->enable = enable;
+
+#ifdef CONFIG_KNOB_MOTOR_ANTICOGGING
+	// The calibration owns the inverter, and leaves it as `enable` says when done
+	if (!motor_lock_idle(data)) {
+		return;
+	}
+#endif /* CONFIG_KNOB_MOTOR_ANTICOGGING */
+
 	if (enable) {
 		inverter_start(config->inverter);
 	} else {
 		inverter_stop(config->inverter);
 	}
+
+#ifdef CONFIG_KNOB_MOTOR_ANTICOGGING
+	k_mutex_unlock(&data->lock);
+#endif /* CONFIG_KNOB_MOTOR_ANTICOGGING */
 }
 
 void motor_set_torque_limit(const struct device *dev, float limit)
@@ -315,24 +835,22 @@ void motor_set_velocity_pid(const struct device *dev, float p, float i, float d)
 	pid_set(&data->pid_velocity, p, i, d);
 }
 
-float motor_get_estimate_angle(const struct device *dev)
+const struct motor_sample *motor_get_sample(const struct device *dev)
 {
 	struct motor_data *data = dev->data;
+	return &data->sample;
+}
 
-	data->raw_angle = encoder_get_full_angle(&data->encoder_state);
-	data->est_angle = lpf_apply(&data->lpf_angle, data->raw_angle);
-
-	return data->est_angle;
+float motor_get_estimate_angle(const struct device *dev)
+{
+	struct motor_data *data = dev->data;
+	return data->sample.angle;
 }
 
 float motor_get_estimate_velocity(const struct device *dev)
 {
 	struct motor_data *data = dev->data;
-
-	data->raw_velocity = encoder_get_velocity(&data->encoder_state);
-	data->est_velocity = lpf_apply(&data->lpf_velocity, data->raw_velocity);
-
-	return data->est_velocity;
+	return data->sample.velocity;
 }
 
 float motor_get_electrical_angle(const struct device *dev)
@@ -347,10 +865,64 @@ float motor_get_electrical_angle(const struct device *dev)
 void motor_reset_rotation_count(const struct device *dev)
 {
 	struct motor_data *data = dev->data;
+
+#ifdef CONFIG_KNOB_MOTOR_ANTICOGGING
+	// The calibration tracks its target in full angles
+	if (!motor_lock_idle(data)) {
+		return;
+	}
+#endif /* CONFIG_KNOB_MOTOR_ANTICOGGING */
+
+	float offset = (float)data->encoder_state.rotation_count * PI2;
+
 	data->encoder_state.rotation_count = 0;
 	data->encoder_state.rotation_count_last = 0;
+
+	// Shift the published sample to the new origin instead of waiting for the next tick
+	data->lpf_angle.output_last -= offset;
+	data->encoder_state.pll_angle -= offset;
+	data->sample.raw_angle -= offset;
+	data->sample.angle -= offset;
+
+#ifdef CONFIG_KNOB_MOTOR_ANTICOGGING
+	k_mutex_unlock(&data->lock);
+#endif /* CONFIG_KNOB_MOTOR_ANTICOGGING */
+}
+
+#ifdef CONFIG_KNOB_TIMER_TRIGGER
+static void motor_tick_trigger_handler(const struct device *inverter, void *user_data)
+{
+	ARG_UNUSED(inverter);
+	k_sem_give((struct k_sem *)user_data);
 }
 
+int motor_set_tick_trigger(const struct device *dev, uint32_t interval_us, struct k_sem *sem)
+{
+	struct motor_data *data = dev->data;
+	const struct motor_config *config = dev->config;
+	int ret;
+
+	if (sem == NULL) {
+		ret = inverter_set_update_handler(config->inverter, 0, NULL, NULL);
+		data->tick_dt = 0.0f;
+	} else {
+		ret = inverter_set_update_handler(config->inverter, interval_us,
+						  motor_tick_trigger_handler, sem);
+		data->tick_dt = ret == 0 ? (float)interval_us * 1e-6f : 0.0f;
+	}
+
+	return ret;
+}
+#else
+int motor_set_tick_trigger(const struct device *dev, uint32_t interval_us, struct k_sem *sem)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(interval_us);
+	ARG_UNUSED(sem);
+	return -ENOTSUP;
+}
+#endif /* CONFIG_KNOB_TIMER_TRIGGER */
+
 struct motor_control *motor_get_control(const struct device *dev)
 {
 	struct motor_data *data = dev->data;
@@ -362,13 +934,113 @@ void motor_inspect(const struct device *dev, struct motor_state *state)
 	struct motor_data *data = dev->data;
 	state->timestamp = time_us();
 	state->control_mode = data->control.mode;
-	state->current_angle = data->est_angle;
-	state->current_velocity = data->est_velocity;
+	state->current_angle = data->sample.angle;
+	state->current_velocity = data->sample.velocity;
 	state->target_angle = data->set_point_angle;
 	state->target_velocity = data->set_point_velocity;
 	state->target_voltage = data->set_point_voltage;
 }
 
+#ifdef CONFIG_KNOB_MOTOR_TRACE
+static void motor_trace_record(const struct device *dev)
+{
+	struct motor_data *data = dev->data;
+	struct motor_trace *trace = &data->trace;
+
+	if (!trace->enable) {
+		return;
+	}
+
+	if (++trace->counter < trace->decimation) {
+		return;
+	}
+	trace->counter = 0;
+
+	// Single producer: only the control loop moves head, only the reader moves tail
+	uint32_t head = (uint32_t)atomic_get(&trace->head);
+	uint32_t tail = (uint32_t)atomic_get(&trace->tail);
+	if (head - tail >= CONFIG_KNOB_MOTOR_TRACE_SIZE) {
+		atomic_inc(&trace->dropped);
+		return;
+	}
+
+	motor_inspect(dev, &trace->states[head % CONFIG_KNOB_MOTOR_TRACE_SIZE]);
+	atomic_set(&trace->head, (atomic_val_t)(head + 1));
+}
+
+int motor_trace_start(const struct device *dev, uint32_t decimation)
+{
+	struct motor_data *data = dev->data;
+	struct motor_trace *trace = &data->trace;
+
+	trace->enable = false;
+
+	trace->decimation = MAX(decimation, 1);
+	trace->counter = 0;
+
+	// A tick may be recording past the enable check, so leave head to it and drop what is
+	// queued by moving tail up instead. Its sample, from before the restart, may still show up.
+	atomic_set(&trace->tail, atomic_get(&trace->head));
+	atomic_clear(&trace->dropped);
+
+	trace->enable = true;
+
+	return 0;
+}
+
+void motor_trace_stop(const struct device *dev)
+{
+	struct motor_data *data = dev->data;
+	data->trace.enable = false;
+}
+
+int motor_trace_read(const struct device *dev, struct motor_state *states, int max,
+		     uint32_t *dropped)
+{
+	struct motor_data *data = dev->data;
+	struct motor_trace *trace = &data->trace;
+
+	uint32_t head = (uint32_t)atomic_get(&trace->head);
+	uint32_t tail = (uint32_t)atomic_get(&trace->tail);
+	int count = MIN((int)(head - tail), max);
+
+	for (int i = 0; i < count; i++) {
+		memcpy(&states[i], &trace->states[(tail + i) % CONFIG_KNOB_MOTOR_TRACE_SIZE],
+		       sizeof(struct motor_state));
+	}
+
+	atomic_set(&trace->tail, (atomic_val_t)(tail + count));
+
+	if (dropped != NULL) {
+		*dropped = (uint32_t)atomic_clear(&trace->dropped);
+	}
+
+	return count;
+}
+#else
+int motor_trace_start(const struct device *dev, uint32_t decimation)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(decimation);
+	return -ENOTSUP;
+}
+
+void motor_trace_stop(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+}
+
+int motor_trace_read(const struct device *dev, struct motor_state *states, int max,
+		     uint32_t *dropped)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(states);
+	ARG_UNUSED(max);
+	ARG_UNUSED(dropped);
+	return -ENOTSUP;
+}
+#endif /* CONFIG_KNOB_MOTOR_TRACE */
+
 static int motor_init(const struct device *dev)
 {
 	struct motor_data *data = dev->data;
@@ -392,7 +1064,13 @@ static int motor_init(const struct device *dev)
 	pid_init(&data->pid_velocity, 0.1f, 0.0f, 0.0f, 1000.0f, data->voltage_limit);
 	pid_init(&data->pid_angle, 80.0f, 0.0f, 0.7f, 0.0f, data->velocity_limit);
 
+#ifdef CONFIG_KNOB_MOTOR_ANTICOGGING
+	k_mutex_init(&data->lock);
+#endif /* CONFIG_KNOB_MOTOR_ANTICOGGING */
+
 	encoder_init(&data->encoder_state, config->encoder);
+	encoder_set_pll(&data->encoder_state, (float)config->pll_bandwidth);
+	motor_update_sample(dev);
 
 	return 0;
 }
@@ -407,10 +1085,17 @@ static int motor_init(const struct device *dev)
 		.enable = false,                                                                   \
 	};                                                                                         \
                                                                                                    \
+	BUILD_ASSERT(DT_INST_ENUM_IDX(n, velocity_estimator) != 1 ||                               \
+			     DT_INST_PROP(n, pll_bandwidth) > 0,                                   \
+		     "pll-bandwidth must be positive for the pll velocity-estimator");             \
+                                                                                                   \
 	struct motor_config motor_config_##n = {                                                   \
 		.inverter = DEVICE_DT_GET(DT_INST_PHANDLE(n, inverter)),                           \
 		.encoder = DEVICE_DT_GET(DT_INST_PHANDLE(n, encoder)),                             \
 		.pole_pairs = DT_INST_PROP(n, pole_pairs),                                         \
+		.pll_bandwidth = DT_INST_ENUM_IDX(n, velocity_estimator) == 1                      \
+					 ? DT_INST_PROP(n, pll_bandwidth)                          \
+					 : 0,                                                      \
 	};                                                                                         \
                                                                                                    \
 	DEVICE_DT_INST_DEFINE(n, motor_init, NULL, &motor_data_##n, &motor_config_##n,             \